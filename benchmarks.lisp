@@ -0,0 +1,47 @@
+; ======================================================================
+; Benchmarks
+; (load 'funcs.lisp) (load 'benchmarks.lisp) and then (bench)
+; Each benchmark is run under (time). Look at (room) afterwards for
+; the gc figures: mark time grows with the memory touched per cell.
+; ======================================================================
+
+; A list of n pseudo random numbers in [0,1000)
+(defun bench-list (n) 
+	(let ((l nil)) 
+		(dotimes (i n) (setq l (cons (mod (* i 7919) 1000) l))) 
+		l))
+
+; Walks the list k times
+(defun bench-walk (l k)
+	(dotimes (i k) (dolist (x l) x))
+	(length l))
+
+; Keeps a large live structure and forces gc k times, so that most of
+; the time goes to marking it
+(defun bench-gc (l k)
+	(dotimes (i k) (gc))
+	(length l))
+
+; A list of n items whose conses are spread over memory: each one is
+; followed by k garbage conses, which become holes once gc'ed
+(defun bench-scattered (n k)
+	(let ((l nil))
+		(dotimes (i n) (setq l (cons i l)) (dotimes (j k) (cons j j)))
+		l))
+
+; List walk throughput over scattered conses. With --gc copying memory
+; is compacted between top level forms, so enter these one at a time
+; and compare with --gc marksweep:
+;	(setq s (bench-scattered 100000 8))
+;	(gc)
+;	(time (bench-walk s 10))
+
+(defun bench-fib (n) (if (< n 2) n (+ (bench-fib (- n 1)) (bench-fib (- n 2)))))
+
+(defun bench ()
+	(let ((big (bench-list 100000)))
+		(time (bench-walk big 10))
+		(time (bench-gc big 20))
+		(time (length (qsort (bench-list 2000))))
+		(time (bench-fib 20)))
+	(room))
@@ -7,13 +7,36 @@
 
 LispClass Lisp;
 
+void LispClass::Init() {
+	LAMBDA = Memory.Intern("lambda");
+	QUOTE  = Memory.Intern("'");
+	Memory.AddRoot(&LAMBDA);
+	Memory.AddRoot(&QUOTE);
+	for (int i = 0; i < NFUNCS; i++) {
+		FUNC(Memory.Intern(Func[i].fname)) = i;
+		Func[i].cond = Func[i].nargs[0];
+		Func[i].n    = atoi(Func[i].nargs+1);
+	}
+}
+
 void LispClass::REPL() {
-	addr bindings = _NIL_;
+	addr bindings = _NEWLIST_;
+	Memory.AddRoot(&bindings);
+	char base;
+	StackBase = &base;
+	if (setjmp(Restart)) { /// From Abort: the bindings and the RootStack are reset below
+		Depth = 0;
+		while (!ISEMPTY(_RETURNS_)) Pop(_RETURNS_);
+		if (TraceFile != stdout) fflush(TraceFile); /// The trace of the aborted form, as after any other
+		while (NLoads) fclose(Loads[--NLoads]);
+	}
 	for (;;) {
-		CAR(bindings) = _DEFVARS_;
-		CDR(bindings) = _NIL_;
+		Memory.SafePoint();	/// No sexpr is held by C code between top level forms
+		SETCAR(bindings, _DEFVARS_);
+		SETCDR(bindings, _NIL_);
 		addr result = Eval(Read(),bindings,0);
 		Print(result);
+		if (TraceFile != stdout) fflush(TraceFile);
 	}
 }
 
@@ -23,8 +46,9 @@ addr LispClass::Read(bool showPrompt) {
 	if (showPrompt) printf("%d%% REPL> ", USEDMEMPCT);
 	char line[MAXLINELENPARSER]; int lineIx = 0;
 	while (true) {
-		char c = fgetc(stdin);
-		if (c == '\n') break;
+		int c = fgetc(stdin);
+		if (c == EOF && lineIx == 0) exit(0); /// End of input, as when it is piped in
+		if (c == EOF || c == '\n') break;
 		line[lineIx++] = c;
 		if (lineIx == MAXLINELENPARSER-1) break;
 	}
@@ -32,7 +56,7 @@ addr LispClass::Read(bool showPrompt) {
 	
 	if (!strcasecmp(line, "?") && showPrompt) {
 		printf("   Toplevel REPL. Percentage before prompt shows used memory.\n");
-		printf("   Ctrl-C returns to OS.\n");
+		printf("   Ctrl-C or end of input returns to OS.\n");
 		printf("   +<enter> repeats last command.\n");
 		printf("   sexpr<enter> evals s-expression.\n");
 		return _T_;
@@ -56,182 +80,359 @@ addr LispClass::Read(bool showPrompt) {
 addr LispClass::Eval(addr sexpr, addr bindings, int level) {
 	/**
 	 * Any memory cell created during the execution of Eval (included called functions)
-	 * should be pushed into GCSAFE to prevent them from being gc'ed if USEDMEMPCT is above the given level.
-	 * In addition, the sexpr and the bindings will be GCSAFEd in the first level Eval. This means that 
+	 * should be protected with Memory.Protect to prevent them from being gc'ed when gc is due (GCNEEDED).
+	 * In addition, the sexpr and the bindings will be protected in the first level Eval. This means that 
 	 * any addr which holds parts of either the sexpr or the bindings will safe before any gc is performed.
 	 * AssocListSet may create memory cells in the passed assoc list, so it may be gc'ed. Note that _DEFUNS_ is 
 	 * always marked to be kept as part of the call to Memory.GC. Also, note that _DEFVARS_ is already part of the
 	 * passed bindings variable, so no need to care for it when used in AssocListSet.
+	 * Forms in tail position (the branches of if, and the last form of progn, cond clauses, let and function
+	 * bodies) are not evaled by a further call: they become sexpr and Eval loops, so tail calls take no C stack.
 	 */
 
+	Deeper();
 	bool traceResult = false;	/// To be updated if the result needs to be traced at the end of the function
+	bool toplevel    = (level == 0);
+	int  frames      = 0;		/// Frames pushed onto bindings by the lets and calls run in place
 	
-	if (level == 0) {
-		Push(sexpr,_GCSAFE_);
-		Push(bindings,_GCSAFE_);
+	if (toplevel) {
+		Memory.Protect(sexpr);
+		Memory.Protect(bindings);
 	}
 
-	if (USEDMEMPCT > PCT_TRIGGER_GC) Memory.GC("At Eval");
-	
 	addr result;
-	if 	(TYPE(sexpr) == 'N') /// Eval a number
-		result = Memory.CreateCell(VALUE(sexpr));
-	else if (TYPE(sexpr) == 'S') { /// Eval a symbol
-		if 		(!strcasecmp(NAME(sexpr), "t"))     result = _T_;
-		else if (!strcasecmp(NAME(sexpr), "nil"))   result = _NIL_;
-		else { /// Look for symbol in the bindings (list of assoc list)
-			addr value;
-			bool found  = false;
-			addr helper = TRAVERSEMARK;
-			addr node   = Traverse(bindings,&helper);
-			while (!ISNIL(node) && !found) {
-				addr assoclist = CAR(node);
-				if (AssocListGet(assoclist, NAME(sexpr), &value))
-					found = true;
-				else
-					node = Traverse(bindings,&helper); 
-			}
-			if (found) result = value; 
-			else {
-				printf("[error] Undefined symbol: %s\n", NAME(sexpr)); result = _NIL_;
+	bool tail;
+	do {
+		tail = false;
+		if (GCNEEDED) Memory.GC("At Eval");
+	
+		if 	(TYPE(sexpr) == 'N') /// Eval a number: numbers are never modified, so no copy is needed
+			result = sexpr;
+		else if (TYPE(sexpr) == 'S') { /// Eval a symbol
+			if (sexpr == _T_) result = _T_;
+			else { /// Look for symbol in the bindings (list of assoc list)
+				addr value;
+				bool found  = false;
+				addr helper = TRAVERSEMARK;
+				addr node   = Traverse(bindings,&helper);
+				while (!ISNIL(node) && !found) {
+					addr assoclist = CAR(node);
+					if (assoclist == _DEFVARS_) break; /// Globals are read from the symbol (see SetGlobal)
+					if (AssocListGet(assoclist, sexpr, &value))
+						found = true;
+					else
+						node = Traverse(bindings,&helper); 
+				}
+				if (!found && GLOBAL(sexpr)) { value = CDR(GLOBAL(sexpr)); found = true; }
+				if (found) result = value; 
+				else {
+					printf("[error] Undefined symbol: %s\n", NAME(sexpr)); result = _NIL_;
+				}
 			}
 		}
-	}
-	else if (TYPE(sexpr) == 'C') { /// Eval a list
-		if (ISNIL(sexpr)) result = _NIL_;
-		else {
-			addr car = CAR(sexpr);
-			if (TYPE(car) == 'S') { /// Potential function call starting with a symbol
-				char *fname  = NAME(car);
-				addr args    = CDR(sexpr);
-				bool builtin = false; 
-				for (int i = 0; i < NFUNCS && !builtin; i++) 
-					if (!strcasecmp(fname,Func[i].fname)) {
-						builtin = true;
+		else if (TYPE(sexpr) == 'C') { /// Eval a list
+			if (ISNIL(sexpr)) result = _NIL_;
+			else {
+				addr car = CAR(sexpr);
+				if (car == _LOCALREF_) /// A parameter of the running defun
+					result = Local(sexpr, bindings, level);
+				else if (TYPE(car) == 'S') { /// Potential function call starting with a symbol
+					addr args    = CDR(sexpr);
+					int  i       = FUNC(car);
+					bool builtin = (i >= 0); 
+					if (builtin) {
 						bool condok; /// Check number of arguments condition
-						switch (Func[i].nargs[0]) {
-							case '<': condok = (Length(args) <  atoi(Func[i].nargs+1)); break;
-							case '=': condok = (Length(args) == atoi(Func[i].nargs+1)); break;
-							case '>': condok = (Length(args) >  atoi(Func[i].nargs+1)); break;
-							case '*': condok = true;
+						switch (Func[i].cond) {
+							case '<': condok = (Length(args) <  Func[i].n); break;
+							case '=': condok = (Length(args) == Func[i].n); break;
+							case '>': condok = (Length(args) >  Func[i].n); break;
+							default:  condok = true;
 						}
+						addr (LispClass::*f)(addr, addr, int) = Func[i].f;
 						if (!condok) {
 							printf("[error] %s: Got %d args, expected %s at ", NAME(CAR(sexpr)), Length(args), Func[i].nargs); Print(sexpr);
 							result = _NIL_;
 						}
-						else {
-							if (Func[i].traced) {
-								traceResult = true;
-								Blanks(level, ">>> "); Print(sexpr);
+						else if (Func[i].traced) {
+							traceResult = true;
+							Blanks(level, ">>> "); Print(sexpr, true, TraceFile);
+							result = (*this.*f)(sexpr,bindings,level+1);
+						}
+						else if (f == &LispClass::if_) { /// Done here, so that the branch is evaled in place
+							level++;
+							sexpr = ISNIL(Eval(Nth(args,0),bindings,level)) ? Nth(args,2) : Nth(args,1);
+							tail  = true;
+						}
+						else if (f == &LispClass::progn || f == &LispClass::cond || f == &LispClass::let) { /// id. the last form
+							level++;
+							addr body = _NIL_, frame;
+							if (f == &LispClass::progn) body = args;
+							else if (f == &LispClass::cond) body = Clause(sexpr,bindings,level);
+							else if (LetFrame(sexpr,bindings,level,&frame) && Length(CDR(args)) > 0) {
+								EnterFrame(frame,bindings,&frames,false);
+								body = CDR(args);
 							}
-							result = (*this.*(Func[i].f))(sexpr,bindings,level+1);
+							tail = EvalTail(body,bindings,level,&sexpr,&result);
 						}
+						else result = (*this.*f)(sexpr,bindings,level+1);
 					}
-				if (!builtin) { /// Potential defuned function
-					addr lambda;
-					if (AssocListGet(_DEFUNS_, fname, &lambda)) {
-						addr func_args = CAR(lambda);
-						addr func_body = CDR(lambda);
-						addr vals_args = args;
-						traceResult = AssocListGet(_TRACEDFUNCS_, fname, NULL);
-						addr r;	result = EvalLambda(fname, func_args, func_body, vals_args, &r, bindings, level) ? r : _NIL_;
-					}
-					else {
-						printf("[error] Undefined function: %s\n", fname); result = _NIL_;
+					if (!builtin) { /// Potential defuned function
+						addr lambda;
+						if (DEFUN(car)) {
+							lambda = CDR(DEFUN(car));
+							addr func_args = CAR(lambda);
+							addr func_body = CDR(lambda);
+							addr vals_args = args;
+							traceResult = TRACED(car);
+							tail = EvalLambda(car, func_args, func_body, vals_args, bindings, level, &frames, &sexpr, &result);
+							if (tail) level++;
+						}
+						else {
+							printf("[error] Undefined function: %s\n", NAME(car)); result = _NIL_;
+						}
 					}
 				}
-			}
-			else if (TYPE(car) == 'C') { /// Potential function call starting with a lambda
-				if (ISNIL(car)) {
-					printf("[error] Undefined function NIL: "); Print(car); result = _NIL_;
-				}
-				else {
-					if (strcasecmp(NAME(CAR(car)), "lambda")) {
-						printf("[error] Expected lambda: "); Print(car); result = _NIL_;
+				else if (TYPE(car) == 'C') { /// Potential function call starting with a lambda
+					if (ISNIL(car)) {
+						printf("[error] Undefined function NIL: "); Print(car); result = _NIL_;
 					}
 					else {
-						if (TYPE(Nth(car,1)) != 'C') {
-							printf("[error] Missing argument list: "); Print(car); result = _NIL_;
+						if (CAR(car) != LAMBDA) {
+							printf("[error] Expected lambda: "); Print(car); result = _NIL_;
 						}
 						else {
-							addr func_args = Nth(car, 1);
-							addr func_body = CDR(CDR(car));
-							addr vals_args = CDR(sexpr);
-							addr r;
-							result = EvalLambda((char *) "lambda", func_args, func_body, vals_args, &r, bindings, level) ? r : _NIL_;
+							if (TYPE(Nth(car,1)) != 'C') {
+								printf("[error] Missing argument list: "); Print(car); result = _NIL_;
+							}
+							else {
+								addr func_args = Nth(car, 1);
+								addr func_body = CDR(CDR(car));
+								addr vals_args = CDR(sexpr);
+								tail = EvalLambda(LAMBDA, func_args, func_body, vals_args, bindings, level, &frames, &sexpr, &result);
+								if (tail) level++;
+							}
 						}
 					}
 				}
-			}
-			else if (TYPE(car) == 'N') { /// Bad function call starting with a number
-				printf("[error] Expected symbol or lambda: %ld\n", VALUE(car)); result = _NIL_;
+				else if (TYPE(car) == 'N') { /// Bad function call starting with a number
+					printf("[error] Expected symbol or lambda: %ld\n", VALUE(car)); result = _NIL_;
+				}
 			}
 		}
-	}
-	if (traceResult) { Blanks(level,"<<< "); Print(result); }
-	if (level == 0)  { Pop(_GCSAFE_); Pop(_GCSAFE_); }
+	} while (tail);
+	for (; frames; frames--) Pop(bindings); /// Leave bindings as it was before extension
+	if (traceResult) { Blanks(level,"<<< "); Print(result, true, TraceFile); }
+	if (toplevel)    { Memory.Unprotect(2); }
+	Depth--;
 	return result;
 }
 
-void LispClass::Print(addr sexpr, bool newline) {
+void LispClass::Print(addr sexpr, bool newline, FILE *out) {
 	if (ISNIL(sexpr)) 
-		printf("NIL"); 
+		fprintf(out, "NIL"); 
 	else 
-		Memory.Print(sexpr);
-	if (newline) printf("\n");
+		Memory.Print(sexpr, out);
+	if (newline) fprintf(out, "\n");
 }
 
-bool LispClass::EvalLambda(char *fname, addr lambdaArgs, addr lambdaBody, addr argValues, addr *result, addr bindings, int level) {
+bool LispClass::EvalLambda(addr fname, addr lambdaArgs, addr lambdaBody, addr argValues, addr bindings, int level,
+						   int *frames, addr *last, addr *result) {
 	int items = Length(lambdaArgs);
 	if (items != Length(argValues)) {
-		printf("[error] %s: Arguments mismatch: ", fname); Print(argValues); 
+		printf("[error] %s: Arguments mismatch: ", NAME(fname)); Print(argValues); 
+		*result = _NIL_;
 		return false;
 	}
-	addr bndg = _NIL_; 	 /// New bindings
-	Push(bndg,_GCSAFE_); /// bndg may be impacted by a gc on the next Eval call, so save it
+	addr bndg = _NEWLIST_; 	 /// New bindings
+	Memory.Protect(bndg); /// bndg may be impacted by a gc on the next Eval call, so save it
 	for (int i = 0; i < items; i++)
-		AssocListSet(bndg, NAME(Nth(lambdaArgs,i)), Eval(Nth(argValues,i), bindings, level+1));
-	Pop(_GCSAFE_);
+		AssocListSet(bndg, Nth(lambdaArgs,i), Eval(Nth(argValues,i), bindings, level+1));
+	Memory.Unprotect();
 	
-	/// Test if the function is in the traced list. If so, print the evaled arguments which
+	/// Test if the function is traced. If so, print the evaled arguments which
 	/// are contained in the generated bindings
-	if (AssocListGet(_TRACEDFUNCS_, fname, NULL)) { 
-		Blanks(level,">>> "); printf("%s ",fname); 
+	bool traced = TRACED(fname);
+	if (traced) { 
+		Blanks(level,">>> "); fprintf(TraceFile, "%s ",NAME(fname)); 
 		addr helper = TRAVERSEMARK;
 		addr node = Traverse(bndg,&helper);
 		while (!ISNIL(node)) {
 			addr item = CAR(node);
-			Print(CDR(item),false); printf(" ");
+			Print(CDR(item),false,TraceFile); fprintf(TraceFile, " ");
 			node = Traverse(bndg,&helper);
 		}
-		printf("\n");
+		fprintf(TraceFile, "\n");
 	}
 
-	Push(bndg,bindings); /// New bindings
-	*result = EvalSequence(lambdaBody,bindings,level+1);
-	Pop(bindings); /// Leave bindings as it was before extension
+	EnterFrame(bndg, bindings, frames, true); /// New bindings, popped by Eval
+	Code *code = (fname != LAMBDA) ? Compiled(fname, lambdaArgs, lambdaBody) : NULL;
+	if (code) 	{ *result = Run(code, bndg, bindings, level+1); return false; }
+	if (traced) { *result = EvalSequence(lambdaBody, bindings, level+1); return false; } /// The trace shows this result alone
+	return EvalTail(lambdaBody, bindings, level+1, last, result);
+}
+
+bool LispClass::EvalTail(addr list, addr bindings, int level, addr *last, addr *result) {
+	addr helper = TRAVERSEMARK;
+	addr node = Traverse(list,&helper);
+	*result = _NIL_;
+	while (!ISNIL(node)) {
+		if (ISNIL(CDR(node))) {
+			*last = CAR(node);
+			return true;
+		}
+		if (Eval(CAR(node),bindings,level) == RETURNMARK) {
+			*result = RETURNMARK;
+			return false;
+		}
+		node = Traverse(list,&helper);
+	}
+	return false;
+}
+
+void LispClass::EnterFrame(addr frame, addr bindings, int *frames, bool call) {
+	Push(frame, bindings);
+	(*frames)++;
+	/// A frame entered before is out of sight once the newer ones bind all of its symbols, so it is dropped:
+	/// a loop of tail calls then keeps as many frames as the newest call needs. Only a call drops frames, all
+	/// of which lie under its own: the frames of the lets around a resolved reference must stay, as its depth
+	/// counts them (see Resolve)
+	if (!call) return;
+	addr prev = bindings;
+	for (int f = 1; f < *frames; ) {
+		addr node = CDR(prev);
+		if (Shadowed(CAR(node), bindings, f)) {
+			SETCDR(prev, CDR(node));
+			(*frames)--;
+		}
+		else { prev = node; f++; }
+	}
+}
+
+bool LispClass::Shadowed(addr frame, addr bindings, int n) {
+	for (addr pair = frame; !ISNIL(pair) && !ISEMPTY(pair); pair = CDR(pair)) {
+		bool bound = false;
+		addr node  = bindings;
+		for (int f = 0; f < n && !bound; f++, node = CDR(node)) bound = AssocListGet(CAR(node), CAR(CAR(pair)), NULL);
+		if (!bound) return false;
+	}
 	return true;
 }
 
+bool LispClass::Distinct(addr params) {
+	/// Slots are positions in the frame built by EvalLambda, which holds a repeated parameter only once
+	for (addr i = params; !ISNIL(i) && !ISEMPTY(i); i = CDR(i))
+		for (addr j = CDR(i); !ISNIL(j); j = CDR(j))
+			if (CAR(i) == CAR(j)) return false;
+	return true;
+}
+
+void LispClass::Resolve(addr params, addr body) {
+	if (!Distinct(params)) return;
+	Scope scope = { params, true, NULL };
+	ResolveForms(body, &scope);
+}
+
+void LispClass::ResolveForms(addr list, const Scope *scope) {
+	for (addr node = list; TYPE(node) == 'C' && !ISNIL(node) && !ISEMPTY(node); node = CDR(node)) {
+		addr form = CAR(node);
+		if (TYPE(form) == 'S') {
+			addr ref = LocalRef(form, scope);
+			if (ref) SETCAR(node, ref);
+		}
+		else if (TYPE(form) == 'C' && !ISNIL(form) && !ISEMPTY(form)) ResolveForm(form, scope);
+	}
+}
+
+void LispClass::ResolveForm(addr form, const Scope *scope) {
+	addr car = CAR(form);
+	if (TYPE(car) == 'C' && !ISNIL(car) && CAR(car) == LAMBDA) { /// EvalLambda binds its parameters in a frame of their own
+		if (TYPE(Nth(car,1)) == 'C') Resolve(Nth(car,1), CDR(CDR(car)));
+		ResolveForms(CDR(form), scope);
+		return;
+	}
+	if (TYPE(car) != 'S' || car == _LOCALREF_) return;
+	if (FUNC(car) < 0) { /// A defuned function: EvalLambda evaluates the arguments in the caller's bindings
+		ResolveForms(CDR(form), scope);
+		return;
+	}
+	addr (LispClass::*f)(addr, addr, int) = Func[FUNC(car)].f;
+	if (f == &LispClass::let) {
+		addr vars = Nth(CDR(form), 0);
+		if (TYPE(vars) != 'C') return;
+		Scope inner = { vars, false, scope }; /// let* evaluates its init forms with its variables pushed
+		const Scope *initscope = strcasecmp(NAME(car), "let*") ? scope : &inner;
+		for (addr node = vars; TYPE(node) == 'C' && !ISNIL(node) && !ISEMPTY(node); node = CDR(node))
+			if (TYPE(CAR(node)) == 'C' && !ISNIL(CAR(node))) ResolveForms(CDR(CAR(node)), initscope);
+		ResolveForms(CDR(CDR(form)), &inner);
+	}
+	else if (f == &LispClass::cond) {
+		for (addr node = CDR(form); TYPE(node) == 'C' && !ISNIL(node) && !ISEMPTY(node); node = CDR(node))
+			ResolveForms(CAR(node), scope);
+	}
+	else if (f == &LispClass::setq)
+		ResolveForms(CDR(CDR(form)), scope);
+	else if (f == &LispClass::if_    || f == &LispClass::bools  || f == &LispClass::zoprs  || f == &LispClass::zcmps  ||
+			 f == &LispClass::list   || f == &LispClass::append || f == &LispClass::cons   || f == &LispClass::carcdr ||
+			 f == &LispClass::eq_    || f == &LispClass::length || f == &LispClass::mod    || f == &LispClass::null   ||
+			 f == &LispClass::nth    || f == &LispClass::print  || f == &LispClass::progn  || f == &LispClass::atom)
+		ResolveForms(CDR(form), scope);
+}
+
+int LispClass::Slot(addr symbol, const Scope *scope, int *depth) {
+	*depth = 0;
+	for (const Scope *s = scope; s; s = s->outer, (*depth)++) {
+		int slot = 0;
+		for (addr node = s->vars; TYPE(node) == 'C' && !ISNIL(node) && !ISEMPTY(node); node = CDR(node), slot++) {
+			addr var = CAR(node);
+			if (TYPE(var) == 'C' && !ISNIL(var)) var = CAR(var);
+			if (var == symbol) return s->params ? slot : -1;
+		}
+	}
+	return -1;
+}
+
+addr LispClass::LocalRef(addr symbol, const Scope *scope) {
+	int depth, slot = Slot(symbol, scope, &depth);
+	if (slot < 0 || depth > 0x3FFF || slot > 0xFFFF) return 0;
+	return Memory.CreateCell(_LOCALREF_, Memory.CreateCell(FIXNUM(depth << 16 | slot), symbol));
+}
+
+addr LispClass::Local(addr ref, addr bindings, int level) {
+	long code   = VALUE(CAR(CDR(ref)));
+	addr symbol = CDR(CDR(ref));
+	addr node   = bindings;
+	/// The frames of the lets in between never bind symbol, as Resolve leaves the references under such a let
+	/// alone. Finding it bound there means the frames are not the ones Resolve counted
+	for (long depth = code >> 16; depth && !ISNIL(node); depth--, node = CDR(node))
+		if (AssocListGet(CAR(node), symbol, NULL)) return Eval(symbol, bindings, level);
+	if (!ISNIL(node) && !ISEMPTY(node)) {
+		node = CAR(node); /// The frame
+		for (long slot = code & 0xFFFF; slot && !ISNIL(node); slot--) node = CDR(node);
+		if (!ISNIL(node) && !ISEMPTY(node) && CAR(CAR(node)) == symbol) return CDR(CAR(node));
+	}
+	return Eval(symbol, bindings, level); /// Not the frames Resolve expected
+}
+
 addr LispClass::EvalSequence(addr list, addr bindings, int level) {
 	addr helper = TRAVERSEMARK;
 	addr node = Traverse(list,&helper);
-	addr result = _NIL_; Push(result,_GCSAFE_);
+	addr result = _NIL_; Memory.Protect(result);
 	while (!ISNIL(node)) {
 		result = Eval(CAR(node),bindings,level);
 		if (result == RETURNMARK) {
-			Pop(_GCSAFE_);
+			Memory.Unprotect();
 			return result;
 		}
 		node = Traverse(list,&helper);
 	}
-	Pop(_GCSAFE_);
+	Memory.Unprotect();
 	return result;
 }
 
 addr LispClass::Traverse(addr list, addr *helper) {
 	if (*helper == TRAVERSEMARK) { 
-		if (!ISNIL(list)) *helper = CDR(list);
+		if (ISEMPTY(list)) return _NIL_; /// So that an empty list head is traversed as NIL
+		*helper = CDR(list);
 		return list;
 	}
 	addr result = *helper;
@@ -240,6 +441,7 @@ addr LispClass::Traverse(addr list, addr *helper) {
 }
 
 int LispClass::Length(addr list) {
+	if (ISEMPTY(list)) return 0;
 	int count = 0;
 	addr item = list;
 	while (true) {
@@ -250,6 +452,7 @@ int LispClass::Length(addr list) {
 }
 
 addr LispClass::Nth(addr list, int n) {
+	if (ISEMPTY(list)) return _NIL_;
 	int count = n;
 	addr item = list;
 	while (count) {
@@ -260,14 +463,14 @@ addr LispClass::Nth(addr list, int n) {
 	return CAR(item);
 }
 
-bool LispClass::AssocListGet(addr assoclist, char *symbol, addr *value) {
-	if (ISNIL(assoclist)) return false;
+bool LispClass::AssocListGet(addr assoclist, addr symbol, addr *value) {
+	if (ISEMPTY(assoclist)) return false;
 	addr helper = TRAVERSEMARK;
 	addr node = Traverse(assoclist,&helper); 
 	bool found = false;
 	while (!ISNIL(node) && !found) {
 		addr cons = CAR(node);
-		if (!strcasecmp(NAME(CAR(cons)), symbol)) {
+		if (CAR(cons) == symbol) {
 			if (value) *value = CDR(cons);
 			found = true;
 		}
@@ -276,25 +479,26 @@ bool LispClass::AssocListGet(addr assoclist, char *symbol, addr *value) {
 	return found;
 }
 
-void LispClass::AssocListSet(addr assoclist, char *symbol, addr value) {
-	if (ISNIL(assoclist)) {
-		addr newcons = Memory.CreateCell(Memory.CreateCell(symbol),value);
-		CAR(assoclist) = newcons;
-		CDR(assoclist) = _NIL_;
+void LispClass::AssocListSet(addr assoclist, addr symbol, addr value) {
+	if (!Modifiable(assoclist)) return;
+	if (ISEMPTY(assoclist)) {
+		addr newcons = Memory.CreateCell(symbol,value);
+		SETCAR(assoclist, newcons);
+		SETCDR(assoclist, _NIL_);
 	}
 	else {
 		addr helper = TRAVERSEMARK;
 		addr node = Traverse(assoclist,&helper);
 		while (!ISNIL(node)) {
 			addr item = CAR(node);
-			if (!strcasecmp(NAME(CAR(item)), symbol)) {
-				CDR(item) = value;
+			if (CAR(item) == symbol) {
+				SETCDR(item, value);
 				break;
 			}
 			if (ISNIL(CDR(node))) {
-				addr newcons = Memory.CreateCell(Memory.CreateCell(symbol),value);
+				addr newcons = Memory.CreateCell(symbol,value);
 				addr newnode = Memory.CreateCell(newcons,_NIL_);
-				CDR(node) = newnode;
+				SETCDR(node, newnode);
 				break;
 			}
 			node = Traverse(assoclist,&helper);
@@ -302,47 +506,51 @@ void LispClass::AssocListSet(addr assoclist, char *symbol, addr value) {
 	}
 }
 
-bool LispClass::AssocListDel(addr assoclist, char *symbol) {
-	if (ISNIL(assoclist)) return false;
+bool LispClass::AssocListDel(addr assoclist, addr symbol) {
+	if (ISEMPTY(assoclist)) return false;
 	addr helper = TRAVERSEMARK;
 	addr node = Traverse(assoclist,&helper);
+	addr prev = _NIL_;
 	while (!ISNIL(node)) {
-		if (!strcasecmp(NAME(CAR(CAR(node))),symbol)) {
-			CAR(node) = CAR(CDR(node));
-			CDR(node) = CDR(CDR(node));
+		if (CAR(CAR(node)) == symbol) {
+			if (ISNIL(CDR(node)) && !ISNIL(prev))
+				SETCDR(prev, _NIL_);			/// Last item: the previous one becomes the last
+			else {
+				SETCAR(node, CAR(CDR(node))); /// Take over the next item (the list head becomes
+				SETCDR(node, CDR(CDR(node))); /// empty if it was the only one)
+			}
 			return true;
 		}
+		prev = node;
 		node = Traverse(assoclist,&helper);
 	}
 	return false;
 }
 
 void LispClass::Push(addr sexpr, addr list) {
-	addr newnode = _NIL_;
-	if (ISNIL(list)) {
-		CAR(list) = sexpr;
-		CDR(list) = newnode;
+	if (!Modifiable(list)) return;
+	if (ISEMPTY(list)) {
+		SETCAR(list, sexpr);
+		SETCDR(list, _NIL_);
 	}
 	else {
-		CAR(newnode) = CAR(list);
-		CDR(newnode) = CDR(list);
-		CAR(list) = sexpr;
-		CDR(list) = newnode;
+		addr newnode = Memory.CreateCell(CAR(list),CDR(list));
+		SETCAR(list, sexpr);
+		SETCDR(list, newnode);
 	}
 }
 
 void LispClass::Pop(addr list) {
-	if (ISNIL(list)) return;
-	CAR(list) = CAR(CDR(list));
-	CDR(list) = CDR(CDR(list));
+	if (ISEMPTY(list) || !Modifiable(list)) return;
+	SETCAR(list, CAR(CDR(list))); /// If list only had one item, it gets the (0,0) of NIL,
+	SETCDR(list, CDR(CDR(list))); /// so it becomes an empty list head
 }
 
 void LispClass::Extend(addr list, addr sexpr) {
-	addr newnode;
-	if (ISNIL(list)) {
-		newnode = _NIL_;
-		CAR(list) = sexpr;
-		CDR(list) = newnode;
+	if (!Modifiable(list)) return;
+	if (ISEMPTY(list)) {
+		SETCAR(list, sexpr);
+		SETCDR(list, _NIL_);
 	}
 	else {
 		addr helper = TRAVERSEMARK;
@@ -351,24 +559,73 @@ void LispClass::Extend(addr list, addr sexpr) {
 			if (ISNIL(CDR(nix))) break;
 			nix = Traverse(list,&helper);
 		}
-		newnode = Memory.CreateCell(sexpr,CDR(nix));
-		CDR(nix) = newnode;
+		SETCDR(nix, Memory.CreateCell(sexpr,_NIL_));
+	}
+}
+
+bool LispClass::Modifiable(addr list) {
+	if (ISNIL(list)) {
+		printf("[error] NIL can't be modified\n");
+		return false;
 	}
+	return true;
 }
 
 addr LispClass::Copy(addr sexpr) {
-	switch (TYPE(sexpr)) {
-		case 'N': return Memory.CreateCell(VALUE(sexpr));
-		case 'S': return Memory.CreateCell(NAME(sexpr));
-		case 'C':
-			if (ISNIL(sexpr)) return _NIL_;
-			return Memory.CreateCell(Copy(CAR(sexpr)),Copy(CDR(sexpr)));
+	/// Iterative: the parts still to be copied are kept in the RootStack as (part, new cell, car?) triplets,
+	/// and the copy is linked in place, so copying does not depend on the C stack
+	addr result = _NIL_;
+	int  pending = 1;
+	Memory.Protect(sexpr); Memory.Protect(_NIL_); Memory.Protect(_T_); /// Into result
+	while (pending--) {
+		addr part = Memory.Protected(2), cell = Memory.Protected(1), car = Memory.Protected(0);
+		Memory.Unprotect(3);
+		addr copy;
+		switch (TYPE(part)) {
+			case 'N': copy = part; break; /// Numbers are never modified
+			case 'S': copy = part; break; /// Symbols are unique
+			case 'C':
+				if (ISNIL(part)) { copy = _NIL_; break; }
+				copy = Memory.CreateCell(_NIL_,_NIL_);
+				if (ISEMPTY(part)) break; /// Copied as (NIL . NIL)
+				Memory.Protect(CDR(part)); Memory.Protect(copy); Memory.Protect(_NIL_);
+				Memory.Protect(CAR(part)); Memory.Protect(copy); Memory.Protect(_T_);
+				pending += 2;
+				break;
+			default: copy = _NIL_;
+		}
+		if 		(ISNIL(cell)) result = copy;
+		else if (ISNIL(car))  SETCDR(cell, copy);
+		else 				  SETCAR(cell, copy);
 	}
-	return _NIL_; 
+	return result;
+}
+
+void LispClass::SetSymbolValue(addr symbol, addr value, addr bindings) {
+	/// Look for symbol in bindings and update if found. Else, set its global value, added to _DEFVARS_ if new
+	bool found  = false;
+	addr helper = TRAVERSEMARK;
+	addr node   = Traverse(bindings,&helper);
+	while (!ISNIL(node) && !found) {
+		addr assoclist = CAR(node);
+		if (assoclist == _DEFVARS_) break;
+		if (AssocListGet(assoclist, symbol, NULL)) {
+			AssocListSet(assoclist, symbol, value);
+			found = true;
+		}
+		else
+			node = Traverse(bindings,&helper); 
+	}
+	if (!found) Memory.SetGlobal(symbol, value);
+}
+
+void LispClass::Abort(const char *why) {
+	printf("[error] %s (depth %d)\n", why, Depth);
+	longjmp(Restart, 1);
 }
 
 void LispClass::Blanks(int level, const char *msg) {
-	printf("[trace] "); for (int i = 0; i < level; i++) printf(" "); printf("%s", msg);
+	fprintf(TraceFile, "[trace] %*s%s", level, "", msg);
 }
 
 /// ********************************************************************
@@ -389,17 +646,17 @@ addr LispClass::append(addr sexpr, addr bindings, int level) {
 			addr cursor;
 			if (!ISNIL(itemv)) {
 				if (result == ENDOFSEXPR) {
-					result = Copy(itemv); Push(result,_GCSAFE_);
+					result = Copy(itemv); Memory.Protect(result);
 					cursor = result;
 				}
 				else 
-					CDR(cursor) = Copy(itemv);
+					SETCDR(cursor, Copy(itemv));
 				while (!ISNIL(CDR(cursor))) cursor = CDR(cursor);
 			}
 			node = Traverse(args,&helper);
 		}
 		if (result == ENDOFSEXPR) return _NIL_;
-		Pop(_GCSAFE_);
+		Memory.Unprotect();
 		return result;
 	}
 	return _NIL_;
@@ -408,12 +665,17 @@ addr LispClass::append(addr sexpr, addr bindings, int level) {
 addr LispClass::apply(addr sexpr, addr bindings, int level) {
 	addr args  = CDR(sexpr);
 	addr fname = Eval(Nth(args,0),bindings,level);
+	Memory.Protect(fname);
 	addr fargs = Eval(Nth(args,1),bindings,level);
+	Memory.Unprotect();
 	if (TYPE(fargs) != 'C') {
 		printf("[error] apply: Bad arguments list: "); Print(fargs); return _NIL_;
 	}
 	addr callsexpr = Memory.CreateCell(fname,fargs);
-	return Eval(callsexpr,bindings,level);
+	Memory.Protect(callsexpr);
+	addr result = Eval(callsexpr,bindings,level);
+	Memory.Unprotect();
+	return result;
 }
 
 addr LispClass::atom(addr sexpr, addr bindings, int level) {
@@ -450,14 +712,14 @@ addr LispClass::bound(addr sexpr, addr bindings, int level) {
 	char *fname = NAME(Nth(sexpr,0));
 	addr symbol = Eval(Nth(sexpr,1),bindings,level);
 	if (!strcasecmp(fname,"boundp")) {
+		if (ISNIL(symbol) || symbol == _T_) return _T_;
 		if (TYPE(symbol) != 'S') {
 			printf("[error] %s: Bad symbol: ", fname); Print(symbol); return _NIL_;
 		}
-		if (!strcasecmp(NAME(symbol),"t") || !strcasecmp(NAME(symbol), "nil")) return _T_;
-		return AssocListGet(_DEFVARS_, NAME(symbol), NULL) ? _T_ : _NIL_;
+		return GLOBAL(symbol) ? _T_ : _NIL_;
 	}
 	else  /// if (!strcasecmp(fname,"fboundp"))
-		return AssocListGet(_DEFUNS_, NAME(symbol), NULL) ? _T_ : _NIL_;
+		return DEFUN(symbol) ? _T_ : _NIL_;
 }
 
 addr LispClass::carcdr(addr sexpr, addr bindings, int level) {
@@ -472,6 +734,10 @@ addr LispClass::carcdr(addr sexpr, addr bindings, int level) {
 }
 
 addr LispClass::cond(addr sexpr, addr bindings, int level) {
+	return EvalSequence(Clause(sexpr,bindings,level),bindings,level);
+}
+
+addr LispClass::Clause(addr sexpr, addr bindings, int level) {
 	addr args = CDR(sexpr);
 	addr helper = TRAVERSEMARK;
 	addr node = Traverse(args,&helper);
@@ -481,7 +747,7 @@ addr LispClass::cond(addr sexpr, addr bindings, int level) {
 			printf("[error] cond: clause should be non NIL: "); Print(clause); return _NIL_;
 		}
 		addr test = CAR(clause);
-		if (!ISNIL(Eval(test,bindings,level))) return EvalSequence(CDR(clause),bindings,level);
+		if (!ISNIL(Eval(test,bindings,level))) return CDR(clause);
 		node = Traverse(args,&helper);
 	}
 	return _NIL_;
@@ -489,7 +755,11 @@ addr LispClass::cond(addr sexpr, addr bindings, int level) {
 
 addr LispClass::cons(addr sexpr, addr bindings, int level) {
 	addr args = CDR(sexpr);
-	return Memory.CreateCell(Eval(Nth(args,0),bindings,level),Eval(Nth(args,1),bindings,level));
+	addr car = Eval(Nth(args,0),bindings,level);
+	Memory.Protect(car); /// Keep safe from the next Eval
+	addr cdr = Eval(Nth(args,1),bindings,level);
+	Memory.Unprotect();
+	return Memory.CreateCell(car,cdr);
 }
 
 addr LispClass::defun(addr sexpr, addr bindings, int level) {
@@ -510,7 +780,10 @@ addr LispClass::defun(addr sexpr, addr bindings, int level) {
 		}
 		node = Traverse(alist,&helper);
 	}
-	AssocListSet(_DEFUNS_, NAME(fname), CDR(CDR(sexpr))); 
+	addr body = Copy(CDR(CDR(CDR(sexpr)))); /// Resolve rewrites the body, which may be a list the caller still holds
+	Resolve(alist, body);
+	Uncompile(fname); /// Its body may be freed, and a later one allocated at the same address
+	Memory.SetDefun(fname, Memory.CreateCell(alist, body));
 	return fname;
 }
 
@@ -529,11 +802,11 @@ addr LispClass::defvarpar(addr sexpr, addr bindings, int level) {
 	}
 	addr value = Eval(Nth(args,1),bindings,level);
 	if (!strcasecmp(NAME(Nth(sexpr,0)), "defvar")) {
-		if (!AssocListGet(_DEFVARS_, NAME(name), NULL)) 
-			AssocListSet(_DEFVARS_, NAME(name), value);
+		if (!GLOBAL(name)) 
+			Memory.SetGlobal(name, value);
 	}
 	else  /// defparameter
-		AssocListSet(_DEFVARS_, NAME(name), value);
+		Memory.SetGlobal(name, value);
 	return name;
 }
 
@@ -547,10 +820,10 @@ addr LispClass::do_(addr sexpr, addr bindings, int level) {
 		printf("[error] do: Bad variable list: "); Print(sexpr); result = _NIL_;
 	}
 	else {
-		addr varvals = _NIL_; 	/// The do variables are held in two assoc lists, one holding the values
-		addr varupds = _NIL_; 	/// and the other one holding the update sexpr.
-		Push(varvals,_GCSAFE_); /// Both need to be GCSAVEd to protect them from potential gc
-		Push(varupds,_GCSAFE_); /// in the upcoming Evals.
+		addr varvals = _NEWLIST_; 	/// The do variables are held in two assoc lists, one holding the values
+		addr varupds = _NEWLIST_; 	/// and the other one holding the update sexpr.
+		Memory.Protect(varvals); /// Both need to be GCSAVEd to protect them from potential gc
+		Memory.Protect(varupds); /// in the upcoming Evals.
 		addr helper = TRAVERSEMARK;
 		addr node = Traverse(vlist,&helper);
 		bool error = false;
@@ -559,8 +832,8 @@ addr LispClass::do_(addr sexpr, addr bindings, int level) {
 			if (TYPE(vspec) != 'C') 	 { error = true; break; }
 			else if (Length(vspec) != 3) { error = true; break; }
 			else {
-				AssocListSet(varvals,NAME(Nth(vspec,0)),Eval(Nth(vspec,1),bindings,level));
-				AssocListSet(varupds,NAME(Nth(vspec,0)),Nth(vspec,2));
+				AssocListSet(varvals,Nth(vspec,0),Eval(Nth(vspec,1),bindings,level));
+				AssocListSet(varupds,Nth(vspec,0),Nth(vspec,2));
 			}
 			node = Traverse(vlist,&helper);
 		}
@@ -585,7 +858,7 @@ addr LispClass::do_(addr sexpr, addr bindings, int level) {
 					while (!ISNIL(node)) {
 						addr varcons = CAR(node);
 						addr newvalue = Eval(CDR(varcons),bindings,level);
-						AssocListSet(varvals,NAME(CAR(varcons)),newvalue);
+						AssocListSet(varvals,CAR(varcons),newvalue);
 						node = Traverse(varupds,&helper);
 					}
 				}
@@ -597,7 +870,7 @@ addr LispClass::do_(addr sexpr, addr bindings, int level) {
 				Pop(bindings);
 			}
 		}
-		Pop(_GCSAFE_); Pop(_GCSAFE_);
+		Memory.Unprotect(2);
 	}
 	return result;
 }
@@ -628,7 +901,7 @@ addr LispClass::doer(addr sexpr, addr bindings, int level) {
 		printf("[error] %s: Bad variable name: ", fname); Print(varspec); return _NIL_;
 	}
 	
-	addr iteritem; 
+	addr iteritem = _NIL_; 
 	if (!strcasecmp(fname, "dolist") || !strcasecmp(fname, "dotimes")) {
 		iteritem = Eval(Nth(varspec,1),bindings,level);
 		if (!strcasecmp(fname, "dolist")) {
@@ -648,39 +921,34 @@ addr LispClass::doer(addr sexpr, addr bindings, int level) {
 		/// Alternatively, iteritem could be set to evaling (mapcar 'car (append _DEFVARS_ _DEFUNS_))
 		/// and using the existing dolist code.
 	}
+	Memory.Protect(iteritem); /// Keep the evaled list or count safe from the gc's in the body
 	
-	addr resultf;
-	if (!strcasecmp(fname, "dolist") || !strcasecmp(fname, "dotimes"))
-		resultf = Nth(varspec,2);
-	else if (!strcasecmp(fname, "do-symbols"))
-		resultf = Nth(varspec,1);
-		
-	addr bndgs = _NIL_; 
+	addr bndgs = _NEWLIST_; 
 	Push(_NIL_,_RETURNS_); /// Get ready for a potential (return) from body
 	bool returnFound = false;
 	if (!strcasecmp(fname, "dolist")) {
 		addr helper = TRAVERSEMARK;
 		addr node = Traverse(iteritem,&helper);
 		while (!ISNIL(node) && !returnFound) {
-			AssocListSet(bndgs, NAME(varname), CAR(node));
+			AssocListSet(bndgs, varname, CAR(node));
 			Push(bndgs,bindings);
 			addr r = EvalSequence(body,bindings,level);
 			Pop(bindings);
 			if (r == RETURNMARK) returnFound = true;
 			else 				 node = Traverse(iteritem,&helper);
 		}
-		AssocListSet(bndgs, NAME(varname), _NIL_); /// Proper last value in case it needs to be evaled in resultf
+		AssocListSet(bndgs, varname, _NIL_); /// Proper last value in case it needs to be evaled in resultf
 	}
 	else if (!strcasecmp(fname, "dotimes")) { 
 		long i = 0;
 		while (true) {
-			AssocListSet(bndgs, NAME(varname), Memory.CreateCell(i));
+			AssocListSet(bndgs, varname, Memory.CreateCell(i));
 			Push(bndgs,bindings);
 			addr r = EvalSequence(body,bindings,level);
 			Pop(bindings);
 			if (r == RETURNMARK) { returnFound = true; break; }
 			i++; if (i == VALUE(iteritem)) {
-				AssocListSet(bndgs, NAME(varname), Memory.CreateCell(i)); /// Proper last value in case it needs to be evaled in resultf
+				AssocListSet(bndgs, varname, Memory.CreateCell(i)); /// Proper last value in case it needs to be evaled in resultf
 				break;
 			}
 		}
@@ -689,7 +957,7 @@ addr LispClass::doer(addr sexpr, addr bindings, int level) {
 		addr helper = TRAVERSEMARK;
 		addr node = Traverse(_DEFVARS_,&helper);
 		while (!ISNIL(node) && !returnFound) {
-			AssocListSet(bndgs, NAME(varname), CAR(CAR(node)));
+			AssocListSet(bndgs, varname, CAR(CAR(node)));
 			Push(bndgs,bindings);
 			addr r = EvalSequence(body,bindings,level);
 			Pop(bindings);
@@ -700,7 +968,7 @@ addr LispClass::doer(addr sexpr, addr bindings, int level) {
 			helper = TRAVERSEMARK;
 			node = Traverse(_DEFUNS_,&helper);
 			while (!ISNIL(node) && !returnFound) {
-				AssocListSet(bndgs, NAME(varname), CAR(CAR(node)));
+				AssocListSet(bndgs, varname, CAR(CAR(node)));
 				Push(bndgs,bindings);
 				addr r = EvalSequence(body,bindings,level);
 				Pop(bindings);
@@ -709,12 +977,18 @@ addr LispClass::doer(addr sexpr, addr bindings, int level) {
 			}
 		}
 	}
+	Memory.Unprotect(); /// iteritem
 	if (returnFound) {
 		addr result = CAR(_RETURNS_);
 		Pop(_RETURNS_);
 		return result;
 	}
 	Pop(_RETURNS_);
+	addr resultf; /// Got after the loop, as Nth may create a cell not safe from the gc's in the body
+	if (!strcasecmp(fname, "dolist") || !strcasecmp(fname, "dotimes"))
+		resultf = Nth(varspec,2);
+	else if (!strcasecmp(fname, "do-symbols"))
+		resultf = Nth(varspec,1);
 	Push(bndgs,bindings); /// Eval the result form with the last binding value
 	addr result = Eval(resultf,bindings,level);
 	Pop(bindings);
@@ -738,93 +1012,70 @@ addr LispClass::eq_(addr sexpr, addr bindings, int level) {
 	addr o1 = Nth(args,0);
 	addr o2 = Nth(args,1);
 	if (o1 == o2) return _T_;
-	addr o1ev, o2ev;
-	if (bindings != DONTUSEBINDINGS) {
-		o1ev = Eval(o1,bindings,level);
-		o2ev = Eval(o2,bindings,level);
-	}
-	else {
-		o1ev = o1;
-		o2ev = o2;
-	}
+	addr o1ev = Eval(o1,bindings,level);
+	Memory.Protect(o1ev);
+	addr o2ev = Eval(o2,bindings,level);
+	Memory.Unprotect();
 	if (TYPE(o1ev) != TYPE(o2ev)) return _NIL_;
 	addr result;
 	switch (TYPE(o1ev)) {
 		case 'C':
 			if (ISNIL(o1ev) && ISNIL(o2ev))
 				result = _T_;
-			else {
-				if (!strcasecmp(fname,"eq") || !strcasecmp(fname,"eql"))
-					result = _NIL_;
-				else { /// !strcasecmp(fname,"equal")
-					/// Check if comparing conses or lists
-					bool o1IsCons = TYPE(CDR(o1ev)) != 'C';
-					bool o2IsCons = TYPE(CDR(o2ev)) != 'C';
-					if (o1IsCons != o2IsCons) 
-						result = _NIL_;
-					else {
-						/**
-						 * Lists and conses comparison for equal could be done by building a temporary sexpr calling Eval in two steps
-						 * equal on the cars and cdrs of o1ev and o2ev. In order for this approach to work, the
-						 * arguments should be quoted to avoid their evaluation:
-						 * 
-						 * 		temp_sexpr --> cons(*,cell1) --> cell1:cons(cell4,cell2) --> cell2:cons(*,cell3) --> cell3:cons(0,0)
-						 * 							V				        V
-						 * 							*:symbol("equal")       cell4:cons(*,cell5) --> cell5:cons(*,cell6) --> cell6:cons(0,0)
-						 * 												               V                       V
-						 * 												               *:symbol("'")           o1ev
-						 * 					   
-						 * 		CAR(cell2) points to a similar cell4->cell5->cell6 link for o2ev.
-						 * 
-						 * All in all, this would ask for the creation of 1+6+3 cons cells and 1+1+1 symbol cells (total of 13 cells) and
-						 * a cumbersome and lenghy code.
-						 * 
-						 * Alternatively the comparison can be done by calls to eq_ using a similarly built sexpr. As in the previous 
-						 * approach, the arguments should not be evaled at the begining of eq_, and this is the reason for using 
-						 * the DONTUSEBINDINGS hack, which avoids quoting them as in the previous approach. All in all, only 3 cons 
-						 * cells and 1 symbol cell is needed for this approach.
-						 * 
-						 * The second approach is preferred to simplify the code at the expense of introducing the DONTUSEBINDINGS hack.
-						 */
-						addr temp_sexpr = _NIL_; 	
-						addr item1 = _NIL_;			/// CAR will be o1ev
-						addr item2 = _NIL_;			/// CAR will be o2ev
-						addr item3 = _NIL_;			/// End of list marker
-						CAR(temp_sexpr) = Memory.CreateCell((char*)"equal");
-						CDR(temp_sexpr) = item1;
-						CDR(item1) = item2;
-						CDR(item2) = item3;
-						if (o1IsCons && o2IsCons) { /// Comparing two conses
-							CAR(item1) = CAR(o1ev);	CAR(item2) = CAR(o2ev); 
-							addr compareCARs = eq_(temp_sexpr, DONTUSEBINDINGS, level);
-							CAR(item1) = CDR(o1ev);	CAR(item2) = CDR(o2ev); 
-							addr compareCDRs = eq_(temp_sexpr, DONTUSEBINDINGS, level);
-							if (ISNIL(compareCARs) || ISNIL(compareCDRs)) result = _NIL_; else result = _T_;
-						}
-						else { /// Comparing two lists
-							if (Length(o1ev) != Length(o2ev)) 
-								result = _NIL_;
-							else {
-								bool allequal = true;
-								for (int i = 0; i < Length(o1ev) && allequal; i++) {
-									CAR(item1) = Nth(o1ev,i);
-									CAR(item2) = Nth(o2ev,i);
-									if (ISNIL(eq_(temp_sexpr,DONTUSEBINDINGS,level))) allequal = false;
-								}
-								result = allequal ? _T_ : _NIL_;
-							}
-						}
-					}
-				}
-			}
+			else if (!strcasecmp(fname,"eq") || !strcasecmp(fname,"eql"))
+				result = _NIL_;
+			else /// !strcasecmp(fname,"equal")
+				result = Equal(o1ev, o2ev) ? _T_ : _NIL_;
 			break;
 		case 'N': result = (VALUE(o1ev) == VALUE(o2ev))         ? _T_ : _NIL_; break;
-		case 'S': result = (!strcasecmp(NAME(o1ev),NAME(o2ev))) ? _T_ : _NIL_; break;
+		case 'S': result = (o1ev == o2ev) ? _T_ : _NIL_; break; /// Symbols are unique
 		default:  result = _NIL_;
 	}
 	return result;
 }
 
+bool LispClass::Equal(addr o1, addr o2) {
+	/// Iterative: the pairs still to be compared are kept in the RootStack, so that the comparison does not
+	/// depend on the C stack however long or deep the lists are
+	int  pending = 1;
+	bool equal   = true;
+	Memory.Protect(o1); Memory.Protect(o2);
+	while (pending && equal) {
+		o1 = Memory.Protected(1); o2 = Memory.Protected(0);
+		Memory.Unprotect(2); pending--;
+		if (o1 == o2) continue;
+		if (TYPE(o1) != TYPE(o2)) { equal = false; continue; }
+		switch (TYPE(o1)) {
+			case 'C': {
+				if (ISNIL(o1) && ISNIL(o2)) break;
+				if (ISEMPTY(o1) || ISEMPTY(o2)) { equal = ISEMPTY(o1) && ISEMPTY(o2); break; }
+				/// Conses compare their cars and cdrs, and lists of the same length their items
+				bool o1IsCons = TYPE(CDR(o1)) != 'C';
+				bool o2IsCons = TYPE(CDR(o2)) != 'C';
+				if (o1IsCons != o2IsCons) equal = false;
+				else if (o1IsCons) {
+					Memory.Protect(CAR(o1)); Memory.Protect(CAR(o2));
+					Memory.Protect(CDR(o1)); Memory.Protect(CDR(o2));
+					pending += 2;
+				}
+				else if (Length(o1) != Length(o2)) equal = false;
+				else {
+					int n = Length(o1);
+					for (int i = 0; i < n; i++, o1 = CDR(o1), o2 = CDR(o2)) {
+						Memory.Protect(CAR(o1)); Memory.Protect(CAR(o2));
+					}
+					pending += n;
+				}
+				break;
+			}
+			case 'N': equal = (VALUE(o1) == VALUE(o2)); break;
+			default:  equal = false; /// Symbols are unique
+		}
+	}
+	Memory.Unprotect(2*pending);
+	return equal;
+}
+
 addr LispClass::eval(addr sexpr, addr bindings, int level) {
 	addr form = CAR(CDR(sexpr));
 	return Eval(Eval(form,bindings,level+1),bindings,level);
@@ -835,15 +1086,51 @@ addr LispClass::ffunc(addr sexpr, addr bindings, int level) {
 	if (!strcasecmp(which, "dumpm")) 
 		Memory.Dump();
 	else if (!strcasecmp(which, "gc")) 
-		Memory.GC("At gc");
+		Memory.GC("At gc", true);
 	return _T_; 
 }
 
+addr LispClass::gcpolicy(addr sexpr, addr bindings, int level) {
+	/// (gc-policy) lists the gc policy parameters, (gc-policy 'name) gets one and (gc-policy 'name value) sets it.
+	/// The new value is used from the next gc on.
+	struct { const char *name; int *value; int min; int max; } params[] = {
+		{"growth", 		  &Memory.GCGrowth, 	  1, 1000},
+		{"max-fill", 	  &Memory.GCMaxFill, 	  1,   99},
+		{"high-survival", &Memory.GCHighSurvival, 1,  100},
+	};
+	int nparams = sizeof(params)/sizeof(params[0]);
+	addr args = CDR(sexpr);
+	if (ISNIL(args)) {
+		addr result = _NEWLIST_;
+		for (int i = 0; i < nparams; i++)
+			Extend(result, Memory.CreateCell(Memory.Intern(params[i].name), Memory.CreateCell((long)*params[i].value)));
+		return result;
+	}
+	addr name = Eval(CAR(args),bindings,level);
+	int i = 0;
+	while (i < nparams && (TYPE(name) != 'S' || strcasecmp(NAME(name), params[i].name))) i++;
+	if (i == nparams) {
+		printf("[error] gc-policy: Unknown parameter: "); Print(name); return _NIL_;
+	}
+	if (!ISNIL(CDR(args))) {
+		addr value = Eval(CAR(CDR(args)),bindings,level);
+		if (TYPE(value) != 'N' || VALUE(value) < params[i].min || VALUE(value) > params[i].max) {
+			printf("[error] gc-policy: %s must be a number from %d to %d\n", params[i].name, params[i].min, params[i].max);
+			return _NIL_;
+		}
+		*params[i].value = VALUE(value);
+	}
+	return Memory.CreateCell((long)*params[i].value);
+}
+
 addr LispClass::funcall(addr sexpr, addr bindings, int level) {
 	addr args  = CDR(sexpr);
 	addr fname = Eval(CAR(args),bindings,level);
 	addr callsexpr = Memory.CreateCell(fname,CDR(args));
-	return Eval(callsexpr,bindings,level);
+	Memory.Protect(callsexpr);
+	addr result = Eval(callsexpr,bindings,level);
+	Memory.Unprotect();
+	return result;
 }
 
 addr LispClass::if_(addr sexpr, addr bindings, int level) {
@@ -864,73 +1151,77 @@ addr LispClass::length(addr sexpr, addr bindings, int level) {
 }
 
 addr LispClass::let(addr sexpr, addr bindings, int level) {
-	addr result;
+	addr result, newbinds;
+	if (!LetFrame(sexpr,bindings,level,&newbinds)) result = _NIL_;
+	else {
+		addr letbody = CDR(CDR(sexpr));
+		if (Length(letbody) > 0) {
+			Push(newbinds,bindings); /// Next Evals are done with the extended bindings
+			result = EvalSequence(letbody,bindings,level);
+			Pop(bindings);
+		}
+		else result = _NIL_;
+	}
+	return result;
+}
+
+bool LispClass::LetFrame(addr sexpr, addr bindings, int level, addr *frame) {
 	char *fname = NAME(CAR(sexpr));
 	addr args   = CDR(sexpr); 
 	addr letvars = Nth(args,0);
 	if (TYPE(letvars) != 'C') {
-		printf("[error] %s: Bad variable spec at ", fname); Print(letvars); result = _NIL_;
+		printf("[error] %s: Bad variable spec at ", fname); Print(letvars);
+		return false;
 	}
-	else {
-		addr letbody  = CDR(args);
-		addr newbinds = _NIL_; Push(newbinds,_GCSAFE_); /// newbinds may be gc'ed in the Eval in loop
-		addr varvalue = _NIL_; Push(varvalue,_GCSAFE_);	/// id. varvalue
-		addr helper   = TRAVERSEMARK;
-		addr nodevars = Traverse(letvars,&helper);
-		bool error = false;
-		while (!ISNIL(nodevars)) {
-			addr variable = CAR(nodevars);
-			addr varsymbol;
-			if (TYPE(variable) == 'S') {
-				varsymbol = variable;
-				varvalue  = _NIL_;
+	addr newbinds = _NEWLIST_; Memory.Protect(newbinds); /// newbinds may be gc'ed in the Eval in loop
+	addr varvalue = _NIL_; Memory.Protect(varvalue);	/// id. varvalue
+	addr helper   = TRAVERSEMARK;
+	addr nodevars = Traverse(letvars,&helper);
+	bool error = false;
+	while (!ISNIL(nodevars)) {
+		addr variable = CAR(nodevars);
+		addr varsymbol;
+		if (TYPE(variable) == 'S') {
+			varsymbol = variable;
+			varvalue  = _NIL_;
+		}
+		else if (TYPE(variable) == 'C') {
+			varsymbol = CAR(variable);
+			if (!TYPE(varsymbol) == 'S') {
+				printf("[error] %s: Bad variable symbol at ", fname); Print(variable);
+				error = true;
+				break;
 			}
-			else if (TYPE(variable) == 'C') {
-				varsymbol = CAR(variable);
-				if (!TYPE(varsymbol) == 'S') {
-					printf("[error] %s: Bad variable symbol at ", fname); Print(variable);
-					error = true;
-					break;
-				}
+			else {
+				addr vexpr = CDR(variable);
+				if (ISNIL(vexpr)) varvalue = _NIL_;
 				else {
-					addr vexpr = CDR(variable);
-					if (ISNIL(vexpr)) varvalue = _NIL_;
-					else {
-						if (!strcasecmp(fname,"let"))
-							varvalue = Eval(CAR(vexpr),bindings,level);
-						else { /// For let* the bindings are used as they are built
-							Push(newbinds,bindings);
-							varvalue = Eval(CAR(vexpr),bindings,level);
-							Pop(bindings);
-						}
+					if (!strcasecmp(fname,"let"))
+						varvalue = Eval(CAR(vexpr),bindings,level);
+					else { /// For let* the bindings are used as they are built
+						Push(newbinds,bindings);
+						varvalue = Eval(CAR(vexpr),bindings,level);
+						Pop(bindings);
 					}
 				}
 			}
-			else if (TYPE(variable) == 'N') {
-				printf("[error] %s: Bad variable symbol at ",fname); Print(variable);
-				error = true;
-				break;
-			}
-			AssocListSet(newbinds, NAME(varsymbol), varvalue);
-			nodevars = Traverse(letvars,&helper);
 		}
-		Pop(_GCSAFE_); Pop(_GCSAFE_);
-		if (error) result = _NIL_;
-		else {
-			if (Length(letbody) > 0) {
-				Push(newbinds,bindings); /// Next Evals are done with the extended bindings
-				result = EvalSequence(letbody,bindings,level);
-				Pop(bindings);
-			}
-			else result = _NIL_;
+		else if (TYPE(variable) == 'N') {
+			printf("[error] %s: Bad variable symbol at ",fname); Print(variable);
+			error = true;
+			break;
 		}
+		AssocListSet(newbinds, varsymbol, varvalue);
+		nodevars = Traverse(letvars,&helper);
 	}
-	return result;
+	Memory.Unprotect(2);
+	*frame = newbinds;
+	return !error;
 }
 
 addr LispClass::list(addr sexpr, addr bindings, int level) {
 	addr args   = CDR(sexpr);
-	addr result = _NIL_; Push(result,_GCSAFE_);
+	addr result = _NEWLIST_; Memory.Protect(result);
 	addr helper = TRAVERSEMARK;
 	addr nargs  = Traverse(args,&helper);
 	while (!ISNIL(nargs)) {
@@ -939,7 +1230,7 @@ addr LispClass::list(addr sexpr, addr bindings, int level) {
 		Extend(result,itemv);
 		nargs = Traverse(args,&helper);
 	}
-	Pop(_GCSAFE_);
+	Memory.Unprotect();
 	return result;
 }
 
@@ -949,16 +1240,22 @@ addr LispClass::load(addr sexpr, addr bindings, int level) {
 	if (TYPE(fname) != 'S') {
 		printf("[error] load: Expected symbol at "); Print(fname); return _NIL_;
 	}
+	if (NLoads == MAXLOADS) {
+		printf("[error] load: More than %d nested loads\n", MAXLOADS); return _NIL_;
+	}
 	FILE *file = fopen(NAME(fname), "r");
 	if (!file) {
 		printf("[error] load: Bad file %s\n", NAME(fname)); return _NIL_;
 	}
+	Loads[NLoads++] = file; /// An Abort from the file longjmps over the fclose below
 	Parser.Init(file);
 	addr s = Parser.Parse(0);
 	while (Parser.Ok) {
 		Eval(s,bindings,0);
 		s = Parser.Parse(0);
 	}
+	fclose(Loads[--NLoads]);
+	if (NLoads) Parser.Init(Loads[NLoads-1]); /// The outer load goes on from its next line
 	return _T_;
 }
 
@@ -982,7 +1279,7 @@ addr LispClass::mapcar(addr sexpr, addr bindings, int level) {
 	addr function;
 	addr functionSexpr = Nth(sexpr,1);
 	if (TYPE(functionSexpr) == 'C') {
-		if (!strcasecmp(NAME(CAR(functionSexpr)), "lambda")) 
+		if (CAR(functionSexpr) == LAMBDA) 
 			function = functionSexpr;
 		else 
 			function = Eval(functionSexpr,bindings,level);
@@ -992,9 +1289,9 @@ addr LispClass::mapcar(addr sexpr, addr bindings, int level) {
 
 	addr lists = CDR(CDR(sexpr)); /// The lists to apply the function to
 	int nth = 0;
-	addr result = _NIL_; Push(result,_GCSAFE_); /// Keep safe from upcoming Evals
+	addr result = _NEWLIST_; Memory.Protect(result); /// Keep safe from upcoming Evals
 	while (true) {
-		addr builtlist = _NIL_; Push(builtlist, _GCSAFE_); /// Keep safe from upcoming Eval
+		addr builtlist = _NEWLIST_; Memory.Protect(builtlist); /// Keep safe from upcoming Eval
 		addr helper = TRAVERSEMARK;
 		addr node = Traverse(lists,&helper);
 		bool noMoreItems = false;
@@ -1002,7 +1299,7 @@ addr LispClass::mapcar(addr sexpr, addr bindings, int level) {
 			addr list = Eval(CAR(node),bindings,level);
 			if (TYPE(list) != 'C') {
 				printf("[error] mapcar: Bad list "); Print(list); 
-				Pop(_GCSAFE_); Pop(_GCSAFE_);
+				Memory.Unprotect(2);
 				return _NIL_;
 			}
 			addr item = Nth(list,nth);
@@ -1010,7 +1307,7 @@ addr LispClass::mapcar(addr sexpr, addr bindings, int level) {
 			Extend(builtlist,item);
 			node = Traverse(lists,&helper);
 		}
-		Pop(_GCSAFE_); /// builtlist
+		Memory.Unprotect(); /// builtlist
 		if (noMoreItems) break;
 		/**
 		 * "builtlist" contains at this point the list of items to be used as arguments to "function".
@@ -1036,33 +1333,41 @@ addr LispClass::mapcar(addr sexpr, addr bindings, int level) {
 		helper = TRAVERSEMARK;
 		node = Traverse(builtlist,&helper);
 		while (!ISNIL(node)) {
-			addr quoteList1 = _NIL_, quoteList2 = _NIL_, quoteList3 = _NIL_;
-			CAR(quoteList1) = Memory.CreateCell((char *)"'");
-			CDR(quoteList1) = quoteList2; 
-			CAR(quoteList2) = CAR(node);
-			CDR(quoteList2) = quoteList3;
-			CAR(node) = quoteList1;
+			addr quoteList1 = _NEWLIST_, quoteList2 = _NEWLIST_;
+			SETCAR(quoteList1, QUOTE);
+			SETCDR(quoteList1, quoteList2); 
+			SETCAR(quoteList2, CAR(node));
+			SETCDR(quoteList2, _NIL_);
+			SETCAR(node, quoteList1);
 			node = Traverse(builtlist,&helper);
 		}
 		/// Prepend the function name:
-		addr sexpr = _NIL_;
-		CAR(sexpr) = function;
-		CDR(sexpr) = builtlist; 
+		addr sexpr = _NEWLIST_;
+		SETCAR(sexpr, function);
+		SETCDR(sexpr, builtlist); 
 		
 		/// Build the result
-		Extend(result,Eval(sexpr,bindings,level));
+		Memory.Protect(sexpr);
+		addr r = Eval(sexpr,bindings,level);
+		Memory.Unprotect();
+		Extend(result,r);
 		nth++;
 	}
-	Pop(_GCSAFE_); /// result;
-	return result;
+	Memory.Unprotect(); /// result;
+	return ISEMPTY(result) ? _NIL_ : result;
 }
 
 addr LispClass::mod(addr sexpr, addr bindings, int level) {
 	addr x = Eval(Nth(sexpr,1),bindings,level);
+	Memory.Protect(x);
 	addr y = Eval(Nth(sexpr,2),bindings,level);
+	Memory.Unprotect();
 	if (TYPE(x) != 'N' || TYPE(y) != 'N') {
 		printf("[error] mod: Arguments must be integers\n"); return _NIL_;
 	}
+	if (VALUE(y) == 0) {
+		printf("[error] mod: Division by zero\n"); return _NIL_;
+	}
 	return Memory.CreateCell(VALUE(x) % VALUE(y));
 }
 
@@ -1092,13 +1397,26 @@ addr LispClass::null(addr sexpr, addr bindings, int level) {
 	return _NIL_;
 }
 
+/**
+ * push and pop modify the list in place, but when the list is to become (or stops being) NIL, which 
+ * can't be modified, the variable holding the list is set instead. Thus, NIL can only be pushed to or 
+ * popped from a place that is a variable.
+ */
 addr LispClass::pop(addr sexpr, addr bindings, int level) {
-	addr list = Eval(Nth(sexpr,1),bindings,level);
+	addr place = Nth(sexpr,1);
+	addr list = Eval(place,bindings,level);
 	if (TYPE(list) != 'C') {
 		printf("[error] pop: Bad list "); Print(list); return _NIL_;
 	}
+	if (ISNIL(list)) return _NIL_;
 	addr result = CAR(list);
-	Pop(list);
+	if (!ISNIL(CDR(list)))
+		Pop(list);
+	else if (TYPE(place) == 'S')
+		SetSymbolValue(place, _NIL_, bindings);
+	else {
+		printf("[error] pop: Place must be a variable to pop the last item "); Print(place); return _NIL_;
+	}
 	return result;
 }
 
@@ -1118,12 +1436,23 @@ addr LispClass::progn(addr sexpr, addr bindings, int level) {
 
 addr LispClass::push(addr sexpr, addr bindings, int level) {
 	addr item = Eval(Nth(sexpr,1),bindings,level);
-	addr place = Eval(Nth(sexpr,2),bindings,level);
-	if (TYPE(place) != 'C') {
-		printf("[error] push: Place must be a list: "); Print(place); return _NIL_;
+	addr place = Nth(sexpr,2);
+	Memory.Protect(item);
+	addr list = Eval(place,bindings,level);
+	Memory.Unprotect();
+	if (TYPE(list) != 'C') {
+		printf("[error] push: Place must be a list: "); Print(list); return _NIL_;
 	}
-	Push(item,place);
-	return place;
+	if (!ISNIL(list)) {
+		Push(item,list);
+		return list;
+	}
+	if (TYPE(place) != 'S') {
+		printf("[error] push: Place must be a variable to push into NIL "); Print(place); return _NIL_;
+	}
+	list = Memory.CreateCell(item,_NIL_);
+	SetSymbolValue(place, list, bindings);
+	return list;
 }
 
 addr LispClass::setf(addr sexpr, addr bindings, int level) {
@@ -1136,6 +1465,7 @@ addr LispClass::setf(addr sexpr, addr bindings, int level) {
 	
 	/// "place" is a symbol
 	if (TYPE(place) == 'S') return setq(sexpr,bindings,level);
+	Memory.Protect(value); /// Keep safe while the place is evaled
 	/// "place" is nth
 	if (!strcasecmp(NAME(CAR(place)), "nth")) {
 		/// Check proper syntax of the nth sexpr. This only prints an error
@@ -1144,24 +1474,29 @@ addr LispClass::setf(addr sexpr, addr bindings, int level) {
 		nth(place,bindings,level);
 		int n = VALUE(Eval(Nth(place,1),bindings,level));
 		addr list = Eval(Nth(place,2),bindings,level);
+		Memory.Unprotect();
 		addr helper = TRAVERSEMARK;
 		addr node = Traverse(list,&helper);
 		while (!ISNIL(node) && n) {
 			node = Traverse(list,&helper);
 			n--;
 		}
-		CAR(node) = value;
+		if (!Modifiable(node)) return _NIL_;
+		SETCAR(node, value);
 		return value;
 	}
 	/// "place" is car or cdr
 	if (!strcasecmp(NAME(CAR(place)), "cdr") || !strcasecmp(NAME(CAR(place)), "car")) {
 		addr list = Eval(Nth(place,1),bindings,level);
+		Memory.Unprotect();
 		if (TYPE(list) != 'C') {
 			printf("[error] setf: Bad list to %s place: ", NAME(CAR(place))); Print(list); return _NIL_;
 		}
-		if (!strcasecmp(NAME(CAR(place)), "cdr")) CDR(list) = value; else CAR(list) = value;
+		if (!Modifiable(list)) return _NIL_;
+		if (!strcasecmp(NAME(CAR(place)), "cdr")) SETCDR(list, value); else SETCAR(list, value);
 		return value;
 	}
+	Memory.Unprotect();
 	printf("[error] setf: Unsupported place "); Print(place); return _NIL_;
 }
 
@@ -1171,21 +1506,8 @@ addr LispClass::setq(addr sexpr, addr bindings, int level) {
 	if (TYPE(symbol) != 'S') {
 		printf("[error] setq: Expected symbol: "); Print(symbol); return _NIL_;
 	}
-	/// Look for symbol in bindings and update if found. Else, add symbol to _DEFVARS_
 	addr value  = Eval(Nth(args,1),bindings,level);
-	bool found  = false;
-	addr helper = TRAVERSEMARK;
-	addr node   = Traverse(bindings,&helper);
-	while (!ISNIL(node) && !found) {
-		addr assoclist = CAR(node);
-		if (AssocListGet(assoclist, NAME(symbol), NULL)) {
-			AssocListSet(assoclist, NAME(symbol), value);
-			found = true;
-		}
-		else
-			node = Traverse(bindings,&helper); 
-	}
-	if (!found) AssocListSet(_DEFVARS_, NAME(symbol), value);
+	SetSymbolValue(symbol, value, bindings);
 	return value;
 }
 
@@ -1197,13 +1519,13 @@ addr LispClass::terpri(addr sexpr, addr bindings, int level) {
 addr LispClass::time(addr sexpr, addr bindings, int level) {
 	long m0  = Memory.Millis();
 	addr nuc = Memory.UsedCells;
-	int  gcd = Memory.GCNumberDone;
+	int  gcd = Memory.GCNumberDone+Memory.GCMinorDone;
 	addr result = Eval(Nth(sexpr,1),bindings,level);
 	printf("Run time.........: %ld ms\n", Memory.Millis()-m0);
-	if (Memory.GCNumberDone == gcd)
+	if (Memory.GCNumberDone+Memory.GCMinorDone == gcd)
 		printf("Cells created........: %d\n", Memory.UsedCells-nuc);
 	else 
-		printf("GCs..............: %d\n", Memory.GCNumberDone-gcd);
+		printf("GCs..............: %d\n", Memory.GCNumberDone+Memory.GCMinorDone-gcd);
 	return result;
 }
 
@@ -1225,9 +1547,9 @@ addr LispClass::trace(addr sexpr, addr bindings, int level) {
 	
 	addr fnames = CDR(sexpr);
 	if (ISNIL(fnames)) { /// Return the names of the traced functions
-		addr result = _NIL_;
+		addr result = _NEWLIST_;
 		/// Check built-in functions:
-		for (int i = 0; i < NFUNCS; i++) if (Func[i].traced) Push(Memory.CreateCell((char *)Func[i].fname),result);	
+		for (int i = 0; i < NFUNCS; i++) if (Func[i].traced) Push(Memory.Intern(Func[i].fname),result);	
 		/// Check defuned functions:
 		addr helper = TRAVERSEMARK;	
 		addr node   = Traverse(_TRACEDFUNCS_,&helper);
@@ -1235,7 +1557,7 @@ addr LispClass::trace(addr sexpr, addr bindings, int level) {
 			Push(CAR(CAR(node)),result);
 			node = Traverse(_TRACEDFUNCS_,&helper);
 		}
-		return result;
+		return ISEMPTY(result) ? _NIL_ : result;
 	}
 	
 	addr helper = TRAVERSEMARK;
@@ -1245,19 +1567,16 @@ addr LispClass::trace(addr sexpr, addr bindings, int level) {
 		if (TYPE(fname) != 'S') {
 			printf("[error] %s: Bad function name ", trfname); Print(fname); return _T_;
 		}
-		bool found = false;
-		for (int i = 0; i < NFUNCS && !found; i++) /// Check if name is a built-in functions
-			if (!strcasecmp(NAME(fname), Func[i].fname)) {
-				Func[i].traced = !strcasecmp(trfname,"trace") ? true : false;
-				found = true;
-				break;
-			}
+		bool found = FUNC(fname) >= 0;
+		if (found) /// Name is a built-in function
+			Func[FUNC(fname)].traced = !strcasecmp(trfname,"trace") ? true : false;
 		if (!found) { /// Check if name is a defuned functions
-			if (AssocListGet(_DEFUNS_, NAME(fname), NULL)) {
-				if (!strcasecmp(trfname,"trace"))
-					AssocListSet(_TRACEDFUNCS_, NAME(fname), _NIL_);
+			if (DEFUN(fname)) {
+				TRACED(fname) = !strcasecmp(trfname,"trace");
+				if (TRACED(fname))
+					AssocListSet(_TRACEDFUNCS_, fname, _NIL_);
 				else 
-					AssocListDel(_TRACEDFUNCS_, NAME(fname));
+					AssocListDel(_TRACEDFUNCS_, fname);
 			}
 			else {
 				printf("[error] %s: Function does not exist: ", trfname); Print(fname); return _T_;
@@ -1271,11 +1590,11 @@ addr LispClass::trace(addr sexpr, addr bindings, int level) {
 addr LispClass::type_of(addr sexpr, addr bindings, int level) {
 	addr obj = Eval(Nth(sexpr,1),bindings,level);
 	if (TYPE(obj) == 'C') {
-		if (ISNIL(obj)) return Memory.CreateCell((char *)"null");
-		return Memory.CreateCell((char *)"cons");
+		if (ISNIL(obj)) return Memory.Intern("null");
+		return Memory.Intern("cons");
 	}
-	else if (TYPE(obj) == 'N') return Memory.CreateCell((char *)"integer");
-	else if (TYPE(obj) == 'S') return Memory.CreateCell((char *)"symbol");
+	else if (TYPE(obj) == 'N') return Memory.Intern("integer");
+	else if (TYPE(obj) == 'S') return Memory.Intern("symbol");
 	else {
 		printf("[error] type-of: Unknown object type "); Print(obj);
 		return _NIL_;
@@ -1303,17 +1622,39 @@ addr LispClass::return_(addr sexpr, addr bindings, int level) {
 
 addr LispClass::room(addr sexpr, addr bindings, int level) {
 	printf("Number of garbage collections...: %d\n",  	 Memory.GCNumberDone);
-	if (Memory.GCNumberDone > 0) {
+	if (Memory.GCMode == GC_GENERATIONAL)
+		printf("Number of minor collections.....: %d\n",  	 Memory.GCMinorDone);
+	if (Memory.GCMode == GC_COPYING)
+		printf("Number of compactions...........: %d\n",  	 Memory.GCCompactions);
+	if (Memory.GCNumberDone+Memory.GCMinorDone > 0) {
 		printf("Conses marked by GC (last)......: %ld\n",	 Memory.GCConsesMarked);
 		printf("Conses freed by GC (total)......: %ld\n", 	 Memory.GCConsesFreed);
 		printf("Time spent in GC (total)........: %ld ms\n", Memory.GCTimeSpent);
-	}
-	printf("Number of conses................: %d\n",  	 MEMSIZE);
-	printf("Bytes per cons..................: %ld\n", 	 sizeof(MemoryCell));
+		printf("Longest GC pause................: %ld us\n", Memory.GCMaxPause);
+		printf("GC survival rate (recent).......: %d%%\n",  Memory.GCSurvival);
+	}
+	printf("Conses in use for next GC.......: %d (growth %d%%, max fill %d%%, high survival %d%%)\n", 
+		Memory.GCTrigger, Memory.GCGrowth, Memory.GCMaxFill, Memory.GCHighSurvival);
+	printf("Number of conses................: %d\n",  	 Memory.Size);
+	printf("Maximum number of conses........: %d\n",  	 Memory.MaxSize);
+	printf("Bytes per cons..................: %ld (+9 bits of type and mark)\n", sizeof(MemoryCell));
 	printf("Conses currently in use.........: %d\n",     Memory.UsedCells);
 	return _T_;
 }
 
+/**
+ * The file name must be a symbol, as in (save-image 'lisp.image), because there are no strings: a name
+ * written as "lisp.image" is read as a symbol with quotes in it, which is then evaled as an undefined variable.
+ * The image is loaded at startup with --image lisp.image.
+ */
+addr LispClass::saveimage(addr sexpr, addr bindings, int level) {
+	addr fname = Eval(Nth(CDR(sexpr),0),bindings,level);
+	if (TYPE(fname) != 'S') {
+		printf("[error] save-image: Expected a quoted symbol as file name, as in (save-image 'file), at "); Print(fname); return _NIL_;
+	}
+	return Memory.SaveImage(NAME(fname)) ? _T_ : _NIL_;
+}
+
 addr LispClass::zoprs(addr sexpr, addr bindings, int level) {
 	char *fname = NAME(CAR(sexpr));
 	addr args = CDR(sexpr);
@@ -1327,6 +1668,10 @@ addr LispClass::zoprs(addr sexpr, addr bindings, int level) {
 			printf("[error] %s: Bad number ", fname); Print(CAR(node));
 			error = true;
 		}
+		else if (*fname == '/' && !firstNumber && VALUE(value) == 0) {
+			printf("[error] /: Division by zero "); Print(CAR(node));
+			error = true;
+		}
 		else {
 			if (firstNumber) { fresult = VALUE(value); firstNumber = false; }
 			else switch (*fname) {
@@ -1345,7 +1690,9 @@ addr LispClass::zoprs(addr sexpr, addr bindings, int level) {
 addr LispClass::zcmps(addr sexpr, addr bindings, int level) {
 	char *fname = NAME(CAR(sexpr)); addr args = CDR(sexpr);
 	addr n1 = Eval(Nth(args,0),bindings,level);
+	Memory.Protect(n1);
 	addr n2 = Eval(Nth(args,1),bindings,level);
+	Memory.Unprotect();
 	if (TYPE(n1) != 'N' || TYPE(n2) != 'N') {
 		printf("[error] %s: Bad numbers ", fname); Print(sexpr); return _NIL_;
 	}
@@ -28,6 +28,13 @@
  * 
  * 			EvalLambda is used to execute both a defuned function or an inline lambda list.
  * 
+ * 			Tail calls: the forms in tail position of if, cond, progn, let and function bodies are not evaled by a
+ * 			nested Eval, but by the same one in a loop (EvalTail leaves the last form of a body to it). The frames
+ * 			which these lets and calls push are popped when Eval returns. On a call, EnterFrame drops any frame
+ * 			pushed before in the same loop whose symbols are all bound by the newer ones, so tail recursion runs in
+ * 			constant C stack and bindings. The frames of lets are never dropped as they are entered, so that the
+ * 			depths Resolve counts stay right. Calls to traced functions and traced builtins are still nested, for the trace.
+ * 
  * 			EvalSequence is used throughout the code to evaluate a implicit sequence of sexprs in different Lisp functions.
  * 			Note on the (return) function:
  * 				The series of sexprs may include a (return) in some Lisp functions for which an implicit NIL block
@@ -43,6 +50,19 @@
  * 							3c. Pop the result from (return) out of the RETURNS stack.
  * 				Check the implementation of "doer" for an example of the above.
  * 
+ * 			Depth limit: Eval and Run count how deep they nest in Depth. Past MaxDepth (--max-depth), or when the
+ * 			C stack is about to run out, Abort prints an error and longjmps back to the REPL, which resets the
+ * 			bindings, the RootStack and RETURNS, and closes the files being loaded (Loads). The REPL runs on a
+ * 			thread whose stack is sized after MaxDepth, so the depth reachable is limited by memory rather than
+ * 			by the default stack of the process. Eval itself still recurses on the C stack, DEPTHSTACK bytes per
+ * 			nesting: its continuations are not kept on the heap, as every builtin which evals its arguments
+ * 			would have to be rewritten around them. Copy, Equal and Memory.Print don't recurse: they keep their
+ * 			pending work in the RootStack.
+ * 
+ * 			Tracing: whether a defuned function is traced is a flag on its symbol (TRACED), so calls to untraced
+ * 			functions cost nothing more. Trace output goes to TraceFile, which with --trace-file is a file written
+ * 			in TRACEBUFFER blocks and flushed after each top level form, instead of a terminal write per line.
+ * 
  * 		Getting information from lists: Traverse, Length, Nth
  * 
  * 			Traverse must be used as shown in the code. Uses a memory hack with TRAVERSEMARK.
@@ -50,7 +70,33 @@
  * 		Modifying or creating lists: Push, Pop, Extend, Copy
  * 
  * 			Variable bindings are extended or reduced as execution progresses via a Push/Pop mechanism.
- * 			The GCSAFE stack is managed via Push/Pop.
+ * 
+ * 		Lexical addressing: Resolve, Local
+ * 
+ * 			Variables are dynamically scoped: a symbol is looked up in each assoc list of the bindings in turn,
+ * 			down to _DEFVARS_, which is not walked: a global value is read from the symbol (GLOBAL). To spare
+ * 			that walk, defun calls Resolve on the body of the function, which replaces the references to the
+ * 			parameters by local references (_LOCALREF_ depth/slot . symbol). At run time the frame built by
+ * 			EvalLambda lies depth assoc lists down the bindings (one per enclosing let), and the value is the
+ * 			slot'th pair of the frame, which Local reaches without searching it. The lets in between never bind
+ * 			the symbol: if one does, the frames are not the ones Resolve counted, and Local looks it up by name.
+ * 			Resolve only descends into forms known to evaluate their arguments in the same bindings: calls to
+ * 			defuned functions, let, let*, setq, cond and the plain builtins (see ResolveForm). Any other form is
+ * 			left as it is and keeps the usual lookup, as do the variables of let, which only shadow parameters.
+ * 			Resolve works on a copy of the body made by defun, as the body may be a list the caller still holds.
+ * 			In a form ((lambda params body) args), the lambda body is resolved against its own params.
+ * 
+ * 		Bytecode: Compiled, Run (vm.cpp)
+ * 
+ * 			EvalLambda runs the body of a defuned function as bytecode, compiled at its first call and kept in
+ * 			the symbol (CODE). Run is a stack machine whose stack is Memory's RootStack. It keeps the bindings
+ * 			as the interpreter does, so variables are still dynamically scoped, and it calls compiled functions
+ * 			directly. A call in tail position runs the callee in the same Run, as Eval does. Constants,
+ * 			parameters, setq, if, cond, and, or, progn, let, let*, do, dotimes, dolist, car, cdr, cons, list,
+ * 			the arithmetic and comparisons are compiled. Any other form is compiled as a call to Eval, and so are
+ * 			forms with errors, calls to traced functions, and forms for traced builtins, so that the messages
+ * 			and the trace output are the interpreter's. Code is compiled again when the function is redefined,
+ * 			or after a compaction, as the constants it holds are addresses.
  * 
  * 		Management of assoc lists: AssocListGet, AssocListSet
  * 
@@ -61,26 +107,50 @@
  * 				three => (a b c)
  */ 
 
+#include <setjmp.h>
 #include "memory.h"
 #include "parser.h"
 
+#define MAXDEPTH	100000	/** Default maximum of nested Evals and Runs (--max-depth)					*/
+#define DEPTHSTACK	2048	/** Bytes of C stack given to the REPL per nesting allowed					*/
+#define STACKSLACK	(1<<20)	/** Bytes of C stack kept for what runs on top of the deepest Eval			*/
+#define TRACEBUFFER	(1<<20)	/** Bytes of trace output buffered before each write to --trace-file		*/
+#define MAXLOADS	16		/** Maximum of nested loads													*/
+
+struct Compiler;
+
 class LispClass {
 friend class ParserClass; /// So that Parser can use Push and Pop
 public:
+	void Init();
 	void REPL();
 	bool TraceRead = false;
+	int  MaxDepth  = MAXDEPTH;
+	long StackSize = 0;			/// Of the C stack the REPL runs on, set before REPL
+	long Stack() { return (long) MaxDepth*DEPTHSTACK + STACKSLACK; }	/// The stack size MaxDepth asks for
+	FILE *TraceFile = stdout;	/// Where trace output goes: stdout, or the --trace-file, fully buffered
 
 private:
 	addr Read(bool showPrompt=true);
 	addr Eval(addr sexpr, addr bindings, int level); /// bindings is a list of assoc lists
-	void Print(addr sexpr, bool newline=true);
+	void Print(addr sexpr, bool newline=true, FILE *out=stdout);
 
-	/// Eval defuned funtions and lambdas
-	bool EvalLambda(char *fname, addr lambdaArgs, addr lambdaBody, addr argValues, addr *result, addr bindings, int level); 
+	/// Eval defuned funtions and lambdas. True if the last form of the body is left in *last for Eval to run in place
+	bool EvalLambda(addr fname, addr lambdaArgs, addr lambdaBody, addr argValues, addr bindings, int level,
+					int *frames, addr *last, addr *result);
 	
 	/// Sequential evaluation of the sexpr in list. Returns last result
 	addr EvalSequence(addr list, addr bindings, int level);
 	
+	/// Tail calls
+	bool EvalTail(addr list, addr bindings, int level, addr *last, addr *result);	/// EvalSequence but the last form,
+																					/// left in *last. False if none
+	void EnterFrame(addr frame, addr bindings, int *frames, bool call);	/// Push frame. For a call, drop the *frames
+																			/// before which it shadows
+	bool Shadowed(addr frame, addr bindings, int n);			/// True if the first n frames bind every symbol in frame
+	addr Clause(addr sexpr, addr bindings, int level);			/// The body of the cond clause chosen
+	bool LetFrame(addr sexpr, addr bindings, int level, addr *frame);	/// The frame of a let or let*. False on error
+	
 	/// Traverse the nodes of a list. 
 	/// Recursion safe thanks to the helper argument (i.e., no static variables are used).
 	/// Returns the nodes of the list (the list item is the CAR of the returned value)
@@ -96,16 +166,72 @@ private:
 	void Pop (addr list);					/// Discard first item in list
 	void Extend(addr list, addr sexpr);		/// Set last item in list
 	addr Copy(addr sexpr);					/// Create a new copy
+	bool Equal(addr o1, addr o2);			/// As Lisp equal
+	bool Modifiable(addr list);				/// False (and error printed) if list is NIL
 	
 	/// Assoc lists are lists of conses, each representing a (symbol value) pair. 
 	/// The bindings of symbols to values is represented by assoc lists.
-	bool AssocListGet(addr assoclist, char *symbol, addr *value);	/// Sets *value to the value of the symbol in assoclist. True if exists
-	void AssocListSet(addr assoclist, char *symbol, addr value);	/// Updates an existing pair or creates a new one
-	bool AssocListDel(addr assoclist, char *symbol);				/// Deletes symbol from the assoc list. Returns true if found and deleted
+	/// Symbols are interned, so they are compared by address.
+	bool AssocListGet(addr assoclist, addr symbol, addr *value);	/// Sets *value to the value of the symbol in assoclist. True if exists
+	void AssocListSet(addr assoclist, addr symbol, addr value);		/// Updates an existing pair or creates a new one
+	bool AssocListDel(addr assoclist, addr symbol);					/// Deletes symbol from the assoc list. Returns true if found and deleted
+	void SetSymbolValue(addr symbol, addr value, addr bindings);	/// Updates symbol in bindings, or sets it as a global variable
+	
+	/// Lexical addressing
+	struct Scope {							/// The variables bound around a form, innermost first
+		addr vars;							/// Parameters or let variable specs
+		bool params;						/// True for the parameters, the only ones with slots
+		const Scope *outer;
+	};
+	void Resolve(addr params, addr body);	/// Resolves the references to params in a defun or lambda body
+	void ResolveForms(addr list, const Scope *scope);	/// Each item in list is a form evaluated in scope
+	void ResolveForm(addr form, const Scope *scope);
+	bool Distinct(addr params);							/// False if a parameter is repeated
+	int  Slot(addr symbol, const Scope *scope, int *depth);	/// -1 if symbol is not a parameter in scope
+	addr LocalRef(addr symbol, const Scope *scope);		/// 0 if symbol has no slot in scope
+	addr Local(addr ref, addr bindings, int level);		/// Value of a local reference
+	
+	/// Bytecode (vm.cpp)
+	struct Code {
+		addr body;			/// Compiled from this body, which keeps the constants alive
+		long stamp;			/// Memory.GCCompactions when compiled
+		int  *ops;			/// NULL if the function can't be compiled
+		addr *consts;
+		int  nparams;
+		int  running;		/// Runs in progress
+		bool retired;		/// To be freed when no longer running
+	};
+	Code *Compiled(addr fname, addr params, addr body);	/// The code of a defuned function, compiled if needed. NULL if none
+	void Uncompile(addr fname);	/// Drops the code of fname, freed once no longer running
+	void FreeCode(Code *code);
+	void CompileSequence(Compiler &c, addr list, const Scope *scope, int d, bool tail=false);	/// tail: the value
+	void CompileForm(Compiler &c, addr form, const Scope *scope, int d, bool tail=false);		/// is returned
+	void CompileBuiltin(Compiler &c, addr form, const Scope *scope, int d, bool tail);
+	void CompileEval(Compiler &c, addr form, int d);
+	bool Compilable(addr vars, bool let);
+	bool CompilableDo(addr args);
+	addr Run(Code *code, addr frame, addr bindings, int level);
+	
+	/// Depth limit
+	int  Depth = 0;				/// Nested Evals and Runs
+	char *StackBase;			/// Where the REPL's C stack starts
+	jmp_buf Restart;			/// Back to the REPL
+	void Deeper() {				/// Called at the start of Eval and Run, which decrement Depth when they return
+		char here;
+		if (++Depth > MaxDepth) 				   Abort("Maximum depth exceeded");
+		if (StackBase - &here > StackSize - STACKSLACK) Abort("Out of C stack");
+	}
+	void Abort(const char *why);	/// Print why and drop the evaluation under way back to the REPL
+	FILE *Loads[MAXLOADS];			/// The files being loaded, closed by the REPL on Abort
+	int  NLoads = 0;
 	
 	/// Utility funcs
 	void Blanks(int level, const char *msg);
 	
+	/// Symbols used by the interpreter, interned by Init
+	addr LAMBDA;
+	addr QUOTE;
+	
 	/// Lisp function implementations
 	addr append		(addr sexpr, addr bindings, int level);
 	addr apply		(addr sexpr, addr bindings, int level);
@@ -123,6 +249,7 @@ private:
 	addr eval		(addr sexpr, addr bindings, int level);
 	addr ffunc		(addr sexpr, addr bindings, int level);
 	addr funcall	(addr sexpr, addr bindings, int level);
+	addr gcpolicy	(addr sexpr, addr bindings, int level);
 	addr if_		(addr sexpr, addr bindings, int level);
 	addr length		(addr sexpr, addr bindings, int level);
 	addr let		(addr sexpr, addr bindings, int level);
@@ -141,6 +268,7 @@ private:
 	addr read		(addr sexpr, addr bindings, int level);
 	addr return_	(addr sexpr, addr bindings, int level);
 	addr room		(addr sexpr, addr bindings, int level);
+	addr saveimage	(addr sexpr, addr bindings, int level);
 	addr setf		(addr sexpr, addr bindings, int level);
 	addr setq		(addr sexpr, addr bindings, int level);
 	addr terpri		(addr sexpr, addr bindings, int level);
@@ -150,12 +278,14 @@ private:
 	addr zoprs		(addr sexpr, addr bindings, int level);
 	addr zcmps		(addr sexpr, addr bindings, int level);
 
-	#define NFUNCS 61
+	#define NFUNCS 63
 	struct {
 		const char *fname;		/// Lisp function
 		const char *nargs;		/// Number of arguments condition
 		addr (LispClass::*f)(addr sexpr, addr bindings, int level);
 		bool traced = false;	/// Tracing flag
+		char cond = 0;			/// nargs parsed by Init: condition character...
+		int  n = 0;				/// ...and number
 	} Func[NFUNCS] = {
 		{"append", 			"*",  &LispClass::append	},	/// append {list}* => list
 		{"apply", 			"=2", &LispClass::apply		},	/// apply function argument-list => result
@@ -180,6 +310,7 @@ private:
 		{"fboundp", 		"=1", &LispClass::bound		},	/// fboundp symbol => boolean
 		{"funcall",			">0", &LispClass::funcall	},	/// funcall function {args}* => result
 		{"gc",				"=0", &LispClass::ffunc		},	/// trigger gc
+		{"gc-policy",		"<3", &LispClass::gcpolicy	},	/// gc-policy [name [value]] => value, or assoc list of all (non standard CL function)
 		{"if",				">1", &LispClass::if_		},	/// if test-form then-form [else-form] => result
 		{"length",			"=1", &LispClass::length	},	/// length list => n
 		{"let",				">0", &LispClass::let		},	/// let ({var | (var [init-form])}*) {form}* => last evaled form
@@ -201,6 +332,7 @@ private:
 		{"read", 			"=0", &LispClass::read		},	/// read
 		{"return", 			"<2", &LispClass::return_	},	/// return [result]
 		{"room", 			"=0", &LispClass::room		},	/// room
+		{"save-image", 		"=1", &LispClass::saveimage	},	/// save-image 'file => boolean (non standard CL function). file is a symbol
 		{"'", 				"=1", &LispClass::quote		},	/// ' object = object
 		{"setf", 			"=2", &LispClass::setf		},	/// setf place newvalue => result. Check source for supported places
 		{"setq", 			"=2", &LispClass::setq		},	/// setq var form => form
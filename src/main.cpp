@@ -1,3 +1,8 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/resource.h>
 #include "memory.h"
 #include "lisp.h"
 
@@ -32,7 +37,73 @@
  * 		Lisp applications at the expense of making the code more complex are disregarded.
 */
 
-int main(int argc, char **argv) {
-	Memory.Init();
+void *REPL(void *) {
 	Lisp.REPL();
+	return NULL;
+}
+
+/// Number of cells in v, which may end in K or M
+addr Cells(const char *v) {
+	char *end; long n = strtol(v, &end, 10);
+	if 		(*end == 'k' || *end == 'K') n *= 1024;
+	else if (*end == 'm' || *end == 'M') n *= 1024*1024;
+	if (n < 1024) 	  n = 1024;
+	if (n > MEMLIMIT) n = MEMLIMIT;
+	return n;
+}
+
+/// The memory size is taken from the command line or from the SIMPLELISP_HEAP and SIMPLELISP_HEAP_MAX
+/// environment variables. The gc mode is one of marksweep (default), generational, copying, incremental or background,
+/// whose slices take up to --gc-pause microseconds. Full gcs mark with --gc-threads threads, 1 by default.
+/// --image starts from a memory image saved with (save-image 'file). --max-depth is the maximum of nested Evals.
+/// --trace-file sends the output of (trace) to a file instead of stdout:
+///		lisp [--heap cells] [--heap-max cells] [--gc mode] [--gc-pause us] [--gc-threads n] [--image file] [--max-depth n]
+///			 [--trace-file file]
+int main(int argc, char **argv) {
+	addr size = MEMSIZE, maxsize = MEMMAXSIZE;
+	long pause = GCPAUSEBUDGET;
+	long threads = 1; /// Parallel marking is opt-in (see MemoryClass)
+	const char *image = NULL, *trace = NULL;
+	if (getenv("SIMPLELISP_HEAP")) 	   size    = Cells(getenv("SIMPLELISP_HEAP"));
+	if (getenv("SIMPLELISP_HEAP_MAX")) maxsize = Cells(getenv("SIMPLELISP_HEAP_MAX"));
+	for (int i = 1; i < argc; i++) {
+		if 		(!strcmp(argv[i], "--heap") 	&& i+1 < argc) size    = Cells(argv[++i]);
+		else if (!strcmp(argv[i], "--heap-max") && i+1 < argc) maxsize = Cells(argv[++i]);
+		else if (!strcmp(argv[i], "--gc") 		&& i+1 < argc && Memory.SetGCMode(argv[i+1])) i++;
+		else if (!strcmp(argv[i], "--gc-pause") && i+1 < argc && atol(argv[i+1]) > 0) pause = atol(argv[++i]);
+		else if (!strcmp(argv[i], "--gc-threads") && i+1 < argc && atol(argv[i+1]) > 0) threads = atol(argv[++i]);
+		else if (!strcmp(argv[i], "--image") 	&& i+1 < argc) image = argv[++i];
+		else if (!strcmp(argv[i], "--trace-file") && i+1 < argc) trace = argv[++i];
+		else if (!strcmp(argv[i], "--max-depth") && i+1 < argc && atol(argv[i+1]) > 0 && atol(argv[i+1]) < (1L << 31)) Lisp.MaxDepth = atol(argv[++i]);
+		else {
+			printf("Usage: %s [--heap cells] [--heap-max cells] [--gc marksweep|generational|copying|incremental|background] [--gc-pause us] [--gc-threads n] [--image file] [--max-depth n] [--trace-file file]\n", argv[0]);
+			printf("Cells may end in K or M. Defaults: --heap %d --heap-max %d --gc-pause %d --gc-threads 1 --max-depth %d\n", MEMSIZE, MEMMAXSIZE, GCPAUSEBUDGET, MAXDEPTH);
+			return 1;
+		}
+	}
+	if (size > maxsize) size = maxsize;
+	if (trace) {
+		Lisp.TraceFile = fopen(trace, "w");
+		if (!Lisp.TraceFile) { printf("[error] Can't open trace file %s\n", trace); return 1; }
+		setvbuf(Lisp.TraceFile, (char *) malloc(TRACEBUFFER), _IOFBF, TRACEBUFFER); /// With NULL, glibc ignores the size
+	}
+	Memory.Init(size, maxsize);
+	Memory.GCPauseBudget = pause;
+	Memory.GCThreads = (threads < 1) ? 1 : (threads > MAXGCTHREADS) ? MAXGCTHREADS : threads;
+	Lisp.Init();
+	if (image && !Memory.LoadImage(image)) return 1;
+	/// The REPL runs on a thread with a stack as deep as --max-depth asks, or else on the process' stack.
+	/// Each nested Eval takes C stack (see Depth limit in lisp.h)
+	pthread_attr_t attr;
+	pthread_t repl;
+	pthread_attr_init(&attr);
+	Lisp.StackSize = Lisp.Stack();
+	if (pthread_attr_setstacksize(&attr, Lisp.StackSize) == 0 && pthread_create(&repl, &attr, REPL, NULL) == 0)
+		pthread_join(repl, NULL);
+	else {
+		struct rlimit rl;
+		getrlimit(RLIMIT_STACK, &rl);
+		Lisp.StackSize = (rl.rlim_cur == RLIM_INFINITY) ? Lisp.Stack() : (long) rl.rlim_cur;
+		REPL(NULL);
+	}
 }
@@ -1,100 +1,286 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <time.h>
+#include <ctype.h>
+#include <strings.h>
+#include <sched.h>
+#include <sys/mman.h>
 #include "memory.h"
 
 MemoryClass Memory;
 
-void MemoryClass::Init() {
-	printf("%d memory cells available (%ld KB)\n", MEMSIZE, MEMSIZE*sizeof(MemoryCell)/1024);
+void MemoryClass::Init(addr size, addr maxsize) {
+	Size    = size;
+	MaxSize = maxsize;
+	Mem   = (MemoryCell *)    Reserve((long)MaxSize*sizeof(MemoryCell));	/// Zero filled by the system,
+	Type  = (char *)          Reserve((long)MaxSize);						/// so all cells are available
+	Marks = (unsigned char *) Reserve((long)MaxSize/8+1);
+	MarkStackSize = 1024;
+	MarkStack = (addr *) malloc(MarkStackSize*sizeof(addr));
+	MarkStackTop  = 0;
+	NurseryCount   = 0;
+	NurserySize    = NURSERYSIZE*2;
+	Nursery        = (addr *) malloc(NurserySize*sizeof(addr));
+	RememberedCount = 0;
+	RememberedSize  = 1024;
+	Remembered      = (addr *) malloc(RememberedSize*sizeof(addr));
+	RememberedBits  = (unsigned char *) Reserve((long)MaxSize/8+1);
+	printf("%d memory cells available (%ld KB), up to %d\n", Size, ((long)Size*(sizeof(MemoryCell)+sizeof(char))+Size/8)/1024, MaxSize);
 	printf("Type ?<enter> for help.\n");
-	for (int i = 0; i < MEMSIZE; i++) {
-		Mem[i].available = true;
-		Mem[i].mark = false;
-	}
+	FreeList = 0;
+	Top      = 1; /// address 0 is never handed out
 	UsedCells      = 0;
 	GCNumberDone   = 0;
 	GCTimeSpent    = 0;
 	GCConsesFreed  = 0;
 	GCConsesMarked = -1;
+	GCMinorDone    = 0;
+	GCCompactions  = 0;
+	GCMaxPause     = 0;
+	GCGrowth       = PCT_GROWTH;
+	GCMaxFill      = PCT_TRIGGER_GC;
+	GCHighSurvival = PCT_HIGHSURVIVAL;
+	GCSurvival     = 0;
+	GCTrigger      = (long)Size*GCMaxFill/100;
+	GCThreshold    = (GCMode == GC_INCREMENTAL) ? (long)GCTrigger*PCT_START_INCGC/100 : GCTrigger;
+	GCPhase        = GC_IDLE;
+	GCPauseBudget  = GCPAUSEBUDGET;
+	SliceCount     = 0;
+	GCThreads      = 1;
+	Workers        = 0;
+	PauseMicros    = 0;
+	LazyAt         = 0;
+	LazyEnd        = 0;
+	SweeperStarted = false;
+	Sweeping       = false;
+	SweptHead      = 0;
+	SweptTail      = 0;
+	GCsAtCompaction = 0;
+	RootCount      = 0;
+	RootStackSize  = 1024;
+	RootStack      = (addr *) malloc(RootStackSize*sizeof(addr));
+	RootStackTop   = 0;
+	
+	ObarraySize  = 1024;
+	ObarrayCount = 0;
+	Obarray = (addr *) calloc(ObarraySize, sizeof(addr));
+	NameArena     = NULL;
+	NameArenaUsed = 0;
+	NameArenaSize = 0;
 	
-	MemIx       = 1; /// address 0 is reserved to represent NIL with a (0,0) cons
-	DEFVARS     = _NIL_;
-	DEFUNS      = _NIL_;
-	GCSAFE      = _NIL_;
-	RETURNS     = _NIL_;
-	TRACEDFUNCS = _NIL_;
+	CreateCell(0,0);	/// NILCELL
+	Intern("T");		/// TCELL
+	DEFVARS     = _NEWLIST_;
+	DEFUNS      = _NEWLIST_;
+	RETURNS     = _NEWLIST_;
+	TRACEDFUNCS = _NEWLIST_;
+	DefvarsLast = DefunsLast = 0;
+	LOCALREF    = Intern(" local");
+	AddRoot(&DEFVARS);
+	AddRoot(&DEFUNS);
+	AddRoot(&RETURNS);
+	AddRoot(&TRACEDFUNCS);
+	AddRoot(&LOCALREF);
 }
 
 addr MemoryClass::CreateCell(addr car, addr cdr) {
-	while (!Mem[MemIx].available) MemIx++; CheckEndOfMemory(); UsedCells++;
-	Mem[MemIx].available = false;
-	Mem[MemIx].type = 'C';
-	Mem[MemIx].car = car;
-	Mem[MemIx].cdr = cdr;
-	MemIx++;
-	return MemIx-1;
+	addr c = NewCell();
+	Type[c] = 'C';
+	Mem[c].car = car;
+	Mem[c].cdr = cdr;
+	return c;
 }
 
 addr MemoryClass::CreateCell(char *t) {
-	while (!Mem[MemIx].available) MemIx++; CheckEndOfMemory(); UsedCells++;
-	Mem[MemIx].available = false;
-	Mem[MemIx].type = IsNumber(t) ? 'N' : 'S';
-	if 		(Mem[MemIx].type == 'N') Mem[MemIx].value = atoi(t);
-	else if (Mem[MemIx].type == 'S') Mem[MemIx].name  = strdup(t);
-	MemIx++;
-	return MemIx-1;
+	if (IsNumber(t)) return CreateCell(atol(t));
+	if (!strcasecmp(t, "nil")) return _NIL_;
+	return Intern(t);
 }
 
 addr MemoryClass::CreateCell(long v) {
-	while (!Mem[MemIx].available) MemIx++; CheckEndOfMemory(); UsedCells++;
-	Mem[MemIx].available = false;
-	Mem[MemIx].type = 'N';
-	Mem[MemIx].value = v;
-	MemIx++;
-	return MemIx-1;
-}
-
-void MemoryClass::Print(addr sexpr) {
-	if 		(Mem[sexpr].type == 'S') printf("%s", Mem[sexpr].name);
-	else if (Mem[sexpr].type == 'N') printf("%ld", Mem[sexpr].value);
-	else if (Mem[sexpr].type == 'C') {
-		if (Mem[sexpr].car == 0 && Mem[sexpr].cdr == 0)
-			printf("()");
-		else if (Mem[Mem[sexpr].cdr].type != 'C') { /// a cons
-			printf("("); Print(Mem[sexpr].car); printf(" . "); Print(Mem[sexpr].cdr); printf(")");
-		}
-		else {
-			printf("(");
-			PrintList(sexpr);
-		}
+	if (v >= FIXNUMMIN && v <= FIXNUMMAX) return FIXNUM(v);
+	addr c = NewCell();
+	Type[c] = 'N';
+	Mem[c].value = v;
+	return c;
+}
+
+addr MemoryClass::Intern(const char *name) {
+	addr mask = ObarraySize-1;
+	addr i = Hash(name) & mask;
+	while (Obarray[i]) {
+		if (!strcasecmp(Mem[Obarray[i]].sym->name, name)) return Obarray[i];
+		i = (i+1) & mask;
+	}
+	addr c = NewCell();
+	Type[c] = 'S';
+	int len = strlen(name);
+	Mem[c].sym = NewRecord(len);
+	Mem[c].sym->func = -1;
+	Mem[c].sym->code = NULL;
+	Mem[c].sym->global = Mem[c].sym->defun = 0;
+	Mem[c].sym->traced = false;
+	memcpy(Mem[c].sym->name, name, len+1);
+	Obarray[i] = c;
+	if (++ObarrayCount*2 > ObarraySize) ObarrayGrow(); /// Keep probe sequences short
+	return c;
+}
+
+addr MemoryClass::Hash(const char *name) {
+	addr h = 5381;
+	while (*name) h = h*33 + tolower((unsigned char)*name++);
+	return h;
+}
+
+void MemoryClass::ObarrayGrow() {
+	addr *old = Obarray; addr oldsize = ObarraySize;
+	ObarraySize *= 2;
+	Obarray = (addr *) calloc(ObarraySize, sizeof(addr));
+	for (addr j = 0; j < oldsize; j++) {
+		if (!old[j]) continue;
+		addr i = Hash(Mem[old[j]].sym->name) & (ObarraySize-1);
+		while (Obarray[i]) i = (i+1) & (ObarraySize-1);
+		Obarray[i] = old[j];
 	}
+	free(old);
 }
 
-void MemoryClass::PrintList(addr sexpr) {
-	Print(Mem[sexpr].car);
-	addr cdr = Mem[sexpr].cdr;
-	if (Mem[cdr].car == 0 && Mem[cdr].cdr == 0) 
-		printf(")");
+SymbolRecord *MemoryClass::NewRecord(int len) {
+	addr bytes = (offsetof(SymbolRecord, name) + len+1 + 7) & ~7; /// Keeps the records aligned
+	if (NameArenaUsed + bytes > NameArenaSize) {
+		addr size = sizeof(char *) + bytes;
+		if (size < NAMEBLOCK) size = NAMEBLOCK;
+		char *block = (char *) malloc(size);
+		*(char **) block = NameArena;
+		NameArena     = block;
+		NameArenaUsed = sizeof(char *);
+		NameArenaSize = size;
+	}
+	SymbolRecord *r = (SymbolRecord *) (NameArena + NameArenaUsed);
+	NameArenaUsed += bytes;
+	return r;
+}
+
+void MemoryClass::FreeNames() {
+	while (NameArena) {
+		char *prev = *(char **) NameArena;
+		free(NameArena);
+		NameArena = prev;
+	}
+	NameArenaUsed = NameArenaSize = 0;
+}
+
+addr MemoryClass::NewCell() {
+	if (FreeList == 0 && LazyAt < LazyEnd) LazySweep();
+	if (FreeList == 0 && __atomic_load_n(&SweptHead, __ATOMIC_ACQUIRE)) TakeSwept(false);
+	CheckEndOfMemory(); UsedCells++;
+	addr c;
+	if (FreeList == 0) c = Top++;
 	else {
-		printf(" ");
-		PrintList(Mem[sexpr].cdr);
+		c = FreeList;
+		FreeList = Mem[c].cdr;
+	}
+	if (GCMode == GC_GENERATIONAL) {
+		if (NurseryCount == NurserySize) { /// Gc can only be done at Eval or parser time, so this may exceed NURSERYSIZE
+			NurserySize *= 2;
+			Nursery = (addr *) realloc(Nursery, NurserySize*sizeof(addr));
+		}
+		Nursery[NurseryCount++] = c;
+	}
+	else if (GCPhase != GC_IDLE) {
+		SliceCount++;
+		if (GCPhase == GC_MARKING || c <= SweepAt) SetMark(c); /// Kept by this cycle. Sweep clears the mark
+	}
+	return c;
+}
+
+void MemoryClass::Remember(addr c) {
+	if (RememberedBits[c>>3] & (1 << (c&7))) return;
+	RememberedBits[c>>3] |= (1 << (c&7));
+	if (RememberedCount == RememberedSize) {
+		RememberedSize *= 2;
+		Remembered = (addr *) realloc(Remembered, RememberedSize*sizeof(addr));
 	}
+	Remembered[RememberedCount++] = c;
+}
+
+bool MemoryClass::Grow() {
+	if (Size == MaxSize) return false;
+	Size = ((long)Size*2 > MaxSize) ? MaxSize : Size*2; /// Nothing else to do: cells from Top up are available
+	printf("[   gc] Memory grown to %d cells\n", Size);
+	return true;
+}
+
+void *MemoryClass::Reserve(long bytes) {
+	void *p = mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+	if (p == MAP_FAILED) {
+		printf("Can't reserve %ld KB of memory.\nDecrease the maximum memory size.\nExiting.\n", bytes/1024);
+		exit(1);
+	}
+	return p;
+}
+
+void MemoryClass::Print(addr sexpr, FILE *out) {
+	/// Iterative: what is still to be printed is kept in the RootStack as (sexpr, what) pairs, so that printing
+	/// does not depend on the C stack however long or deep the lists are
+	enum { SEXPR, REST, DOT, CLOSE }; /// REST are the items of a list after the one just printed
+	int pending = 0;
+	#define PENDING(x, what) { Protect(x); Protect(FIXNUM(what)); pending++; }
+	PENDING(sexpr, SEXPR);
+	while (pending) {
+		addr x    = Protected(1);
+		int  what = FIXNUMVALUE(Protected(0));
+		Unprotect(2); pending--;
+		if (what == DOT) 	  fprintf(out, " . ");
+		else if (what == CLOSE) fprintf(out, ")");
+		else if (what == REST) {
+			addr cdr = Mem[x].cdr;
+			if (TYPE(cdr) != 'C') { /// a dotted list
+				PENDING(_NIL_, CLOSE); PENDING(cdr, SEXPR); PENDING(_NIL_, DOT);
+			}
+			else if (Mem[cdr].car == 0 && Mem[cdr].cdr == 0) 
+				fprintf(out, ")");
+			else {
+				fprintf(out, " ");
+				PENDING(cdr, REST); PENDING(Mem[cdr].car, SEXPR);
+			}
+		}
+		else if (ISFIXNUM(x))	 fprintf(out, "%ld", FIXNUMVALUE(x));
+		else if (Type[x] == 'S') fprintf(out, "%s", Mem[x].sym->name);
+		else if (Type[x] == 'N') fprintf(out, "%ld", Mem[x].value);
+		else if (Type[x] == 'C') {
+			if (Mem[x].car == LOCALREF) {
+				PENDING(Mem[Mem[x].cdr].cdr, SEXPR);
+			}
+			else if (Mem[x].car == 0 && Mem[x].cdr == 0)
+				fprintf(out, "()");
+			else if (TYPE(Mem[x].cdr) != 'C') { /// a cons
+				fprintf(out, "(");
+				PENDING(_NIL_, CLOSE); PENDING(Mem[x].cdr, SEXPR); PENDING(_NIL_, DOT); PENDING(Mem[x].car, SEXPR);
+			}
+			else {
+				fprintf(out, "(");
+				PENDING(x, REST); PENDING(Mem[x].car, SEXPR);
+			}
+		}
+	}
+	#undef PENDING
 }
 
 void MemoryClass::Dump() {
 	const int addrsz = 4;
-	addr upperlimit = MEMSIZE-1;
-	while (Mem[upperlimit].available) upperlimit--;
+	addr upperlimit = Top-1;
+	while (!Type[upperlimit]) upperlimit--;
 	
 	bool inAvaSpc = false;
 	for (int i = 0; i < addrsz*3+4; i++) printf("*"); printf("\n");
-	printf("Used %d/%d (%d%%)\n", UsedCells, MEMSIZE, (UsedCells*100)/MEMSIZE);
+	printf("Used %d/%d (%d%%)\n", UsedCells, Size, USEDMEMPCT);
 	for (int i = 0; i < upperlimit+1; i++) {
-		if (i == 0) printf("%0*d NIL\n", addrsz, i);
+		if (i == 0) continue;
 		else {
-			if (Mem[i].available) {
+			if (!Type[i]) {
 				if (!inAvaSpc) inAvaSpc = true;
 			}
 			else {
@@ -102,14 +288,14 @@ void MemoryClass::Dump() {
 					for (int i = 0; i < addrsz; i++) printf("."); printf("\n");
 					inAvaSpc = false;
 				}
-				printf("%0*d %c ", addrsz, i, Mem[i].type);
-				if 		(Mem[i].type == 'S') printf("%s\n", Mem[i].name);
-				else if (Mem[i].type == 'N') printf("%ld\n", Mem[i].value);
-				else if (Mem[i].type == 'C') {
+				printf("%0*d %c ", addrsz, i, Type[i]);
+				if 		(Type[i] == 'S') printf("%s\n", Mem[i].sym->name);
+				else if (Type[i] == 'N') printf("%ld\n", Mem[i].value);
+				else if (Type[i] == 'C') {
 					printf("%0*d %0*d", addrsz, Mem[i].car, addrsz, Mem[i].cdr);
-					if 		(i == DEFVARS) 		printf(" DEFVARS\n");
+					if 		(i == NILCELL) 		printf(" NIL\n");
+					else if (i == DEFVARS) 		printf(" DEFVARS\n");
 					else if (i == DEFUNS)  		printf(" DEFUNS\n");
-					else if (i == GCSAFE)  		printf(" GCSAFE\n");
 					else if (i == RETURNS) 		printf(" RETURNS\n");
 					else if (i == TRACEDFUNCS) 	printf(" TRACEDFUNCS\n");
 					else 				   		printf("\n");
@@ -120,29 +306,376 @@ void MemoryClass::Dump() {
 	for (int i = 0; i < addrsz*3+4; i++) printf("*"); printf("\n");
 }
 
-bool MemoryClass::IsNIL(addr c) {
-	if (Mem[c].type == 'C' && Mem[c].car == 0 && Mem[c].cdr == 0) return true;
-	return false;
+void MemoryClass::GC(const char *msg, bool full) {
+	if (GCMode == GC_GENERATIONAL && !full && UsedCells <= GCTrigger) { MinorGC(msg); return; }
+	if (GCMode == GC_INCREMENTAL) { IncrementalGC(msg, full); return; }
+	GCNumberDone++;
+	addr before = UsedCells;
+	long u0 = Micros();
+	long m0 = Millis();
+	if (GCMode == GC_BACKGROUND) WaitSweeper();
+	if (GCMode == GC_GENERATIONAL) memset(Marks, 0, Top/8+1); /// Old cells keep their marks between gcs
+	else {
+		ClearMarks(LazyAt, LazyEnd); /// Left by the last gc where not swept yet. Its garbage is still garbage
+		LazyAt = LazyEnd = 0;
+		SetMark(NILCELL);
+		for (addr i = 0; i < ObarraySize; i++) if (Obarray[i]) SetMark(Obarray[i]); /// Symbols are never gc'ed
+	}
+	GCConsesMarked = 0;
+	if (GCThreads > 1) ParallelMark();
+	else MarkRoots();
+	printf("[   gc] %s >> Used mem: %d%%\n", msg, USEDMEMPCT);
+	long markms = Millis()-m0; if (markms > 0) GCTimeSpent += markms;
+	long m1 = Millis();
+	if (GCMode == GC_GENERATIONAL) Sweep();
+	else {
+		addr live = GCConsesMarked + ObarrayCount + 1;
+		GCConsesFreed += UsedCells - live;
+		UsedCells = live;
+		FreeList = 0; /// Available cells are chained again as they are swept, so none is taken from the part not swept
+		if (GCMode == GC_BACKGROUND) StartSweeper();
+		else {
+			LazyAt  = TCELL+1;
+			LazyEnd = Top;
+		}
+	}
+	long sweepms = Millis()-m1; if (sweepms > 0) GCTimeSpent += sweepms;
+	printf("[   gc]    Mark/Sweep %ld/%ld ms\n", markms, sweepms);
+	AdaptTrigger(before);
+	printf("[   gc] << Used mem: %d%%\n", USEDMEMPCT);
+	long us = Micros()-u0; if (us > GCMaxPause) GCMaxPause = us;
+}
+
+void MemoryClass::IncrementalGC(const char *msg, bool full) {
+	long u0 = Micros();
+	if (full) { /// Finishes the current cycle, if any, and then does a whole new one
+		if (GCPhase != GC_IDLE) Slice(-1);
+		StartCycle(msg);
+		Slice(-1);
+	}
+	else {
+		if (GCPhase == GC_IDLE) StartCycle(msg);
+		Slice(UsedCells > GCTrigger ? -1 : GCPauseBudget); /// Gc is not keeping up: finish now
+	}
+	Pause(Micros()-u0);
 }
 
-void MemoryClass::GC(const char *msg) {
+void MemoryClass::StartCycle(const char *msg) {
 	GCNumberDone++;
+	GCConsesMarked = 0;
+	SliceNumber    = 0;
+	CycleUsedCells = UsedCells;
+	for (int i = 0; i < RootCount; i++) Gray(*Roots[i]);
+	for (addr i = 0; i < RootStackTop; i++) Gray(RootStack[i]); /// Sexprs protected later are reachable now, or new
+	GCPhase = GC_MARKING;
+	printf("[   gc] %s (incremental) >> Used mem: %d%%\n", msg, USEDMEMPCT);
+}
+
+void MemoryClass::Slice(long budget) {
+	long t0 = Micros();
+	SliceNumber++;
+	SliceCount = 0;
+	if (GCPhase == GC_MARKING) {
+		if (!Trace(budget, t0)) return;
+		GCPhase    = GC_SWEEPING;
+		SweepAt    = Top-1;	/// Cells from Top up are created unmarked from now on
+		SweepFreed = 0;
+	}
+	if (!SweepSome(budget, t0)) return;
+	GCPhase = GC_IDLE;
+	GCConsesFreed += SweepFreed;
+	AdaptTrigger(CycleUsedCells);
+	printf("[   gc] << Used mem: %d%% (%d slices)\n", USEDMEMPCT, SliceNumber);
+}
+
+bool MemoryClass::SweepSome(long budget, long t0) {
+	/// Freed cells go to the free list as they are, so its order is not kept here
+	for (long n = 1; SweepAt > TCELL; SweepAt--, n++) {
+		addr i = SweepAt;
+		if (Type[i] && Type[i] != 'S' && !IsMarked(i)) {
+			Type[i] = 0; Poison(i);
+			Mem[i].cdr = FreeList; FreeList = i;
+			UsedCells--;
+			SweepFreed++;
+		}
+		Marks[i>>3] &= ~(1 << (i&7));
+		if (budget >= 0 && (n & 4095) == 0 && Micros()-t0 >= budget) { SweepAt--; return false; }
+	}
+	return true;
+}
+
+void MemoryClass::AdaptTrigger(addr before) {
+	int survival = before ? (int)((long)UsedCells*100/before) : 0;
+	GCSurvival = GCNumberDone == 1 ? survival : (GCSurvival+survival)/2; /// Recent gcs weigh most
+	if (GCSurvival > GCHighSurvival) Grow(); /// Gc would free little
+	long live    = UsedCells;
+	long trigger = live + live*GCGrowth/100;
+	long maxfill = (long)Size*GCMaxFill/100;
+	while (trigger > maxfill && Grow()) maxfill = (long)Size*GCMaxFill/100;
+	if (trigger < maxfill) trigger = maxfill; /// No need to gc while memory is there
+	if (trigger > maxfill) { /// Memory can't grow: at least leave half the available cells to be used before the next gc
+		trigger = live + (Size-live)/2;
+		if (trigger < maxfill) trigger = maxfill;
+	}
+	GCTrigger   = trigger;
+	GCThreshold = (GCMode == GC_INCREMENTAL) ? live + (trigger-live)*PCT_START_INCGC/100 : trigger;
+}
+
+void MemoryClass::Pause(long us) {
+	if (us > GCMaxPause) GCMaxPause = us;
+	PauseMicros += us;
+	GCTimeSpent += PauseMicros/1000;
+	PauseMicros %= 1000;
+}
+
+void MemoryClass::MinorGC(const char *msg) {
+	GCMinorDone++;
+	long u0 = Micros();
 	long m0 = Millis();
-	for (addr i = 0; i < MEMSIZE; i++) Mem[i].mark = false;
 	GCConsesMarked = 0;
-	Mark(_DEFVARS_);
-	Mark(_DEFUNS_);
-	Mark(_GCSAFE_);
-	Mark(_RETURNS_);
-	Mark(_TRACEDFUNCS_);
-	printf("[   gc] %s >> Used mem: %d%%\n", msg, USEDMEMPCT);
+	for (addr i = 0; i < RememberedCount; i++) { /// Old cells which may point to young ones
+		addr c = Remembered[i];
+		RememberedBits[c>>3] &= ~(1 << (c&7));
+		if (Type[c] == 'C' && Mem[c].car != 0) {
+			Mark(Mem[c].car);
+			Mark(Mem[c].cdr);
+		}
+	}
+	RememberedCount = 0;
+	MarkRoots();
+	printf("[   gc] %s (minor) >> Used mem: %d%%\n", msg, USEDMEMPCT);
 	long markms = Millis()-m0; if (markms > 0) GCTimeSpent += markms;
 	long m1 = Millis();
-	Sweep();
+	MinorSweep();
 	long sweepms = Millis()-m1; if (sweepms > 0) GCTimeSpent += sweepms;
 	printf("[   gc]    Mark/Sweep %ld/%ld ms\n", markms, sweepms);
 	printf("[   gc] << Used mem: %d%%\n", USEDMEMPCT);
-	MemIx = 1; /// Start over when CreateCons is called
+	long us = Micros()-u0; if (us > GCMaxPause) GCMaxPause = us;
+}
+
+void MemoryClass::MinorSweep() {
+	addr freed = 0;
+	for (addr i = 0; i < NurseryCount; i++) { /// Marked cells stay marked: they are old now
+		addr c = Nursery[i];
+		if (Type[c] && Type[c] != 'S' && !IsMarked(c)) {
+			Type[c] = 0; Poison(c);
+			Mem[c].cdr = FreeList; FreeList = c;
+			freed++;
+		}
+	}
+	NurseryCount = 0;
+	UsedCells -= freed;
+	GCConsesFreed += freed;
+}
+
+bool MemoryClass::SetGCMode(const char *name) {
+	if 		(!strcasecmp(name, "marksweep")) 	GCMode = GC_MARKSWEEP;
+	else if (!strcasecmp(name, "generational")) GCMode = GC_GENERATIONAL;
+	else if (!strcasecmp(name, "copying")) 		GCMode = GC_COPYING;
+	else if (!strcasecmp(name, "incremental")) 	GCMode = GC_INCREMENTAL;
+	else if (!strcasecmp(name, "background")) 	GCMode = GC_BACKGROUND;
+	else return false;
+	return true;
+}
+
+#define IMAGEMAGIC "SLIMAGE3"
+
+bool MemoryClass::SaveImage(const char *file) {
+	FILE *f = fopen(file, "wb");
+	if (!f) { printf("[error] Can't create image %s\n", file); return false; }
+	int cellsize = sizeof(MemoryCell);
+	fwrite(IMAGEMAGIC, 1, 8, f);
+	fwrite(&cellsize, sizeof(int), 1, f);
+	fwrite(&Top, sizeof(addr), 1, f);
+	fwrite(&ObarraySize, sizeof(addr), 1, f);
+	fwrite(&ObarrayCount, sizeof(addr), 1, f);
+	fwrite(&RootCount, sizeof(int), 1, f);
+	for (int i = 0; i < RootCount; i++) fwrite(Roots[i], sizeof(addr), 1, f);
+	fwrite(Mem, sizeof(MemoryCell), Top, f);
+	fwrite(Type, 1, Top, f);
+	fwrite(Obarray, sizeof(addr), ObarraySize, f);
+	for (addr i = 0; i < ObarraySize; i++) { /// In the same order, so the names need no addresses
+		if (!Obarray[i]) continue;
+		int len = strlen(Mem[Obarray[i]].sym->name);
+		fwrite(&len, sizeof(int), 1, f);
+		fwrite(&Mem[Obarray[i]].sym->func, sizeof(int), 1, f);
+		fwrite(Mem[Obarray[i]].sym->name, 1, len, f);
+	}
+	bool ok = !ferror(f);
+	if (fclose(f) != 0) ok = false;
+	if (!ok) printf("[error] Can't write image %s\n", file);
+	return ok;
+}
+
+bool MemoryClass::LoadImage(const char *file) {
+	/// Only to be called at startup, once Memory.Init and Lisp.Init have registered their roots
+	FILE *f = fopen(file, "rb");
+	if (!f) { printf("[error] Can't open image %s\n", file); return false; }
+	char magic[8]; int cellsize; addr top, obsize, obcount; int rootcount;
+	if (fread(magic, 1, 8, f) != 8 || memcmp(magic, IMAGEMAGIC, 8) ||
+		fread(&cellsize, sizeof(int), 1, f) != 1 || cellsize != sizeof(MemoryCell) ||
+		fread(&top, sizeof(addr), 1, f) != 1 || fread(&obsize, sizeof(addr), 1, f) != 1 ||
+		fread(&obcount, sizeof(addr), 1, f) != 1 || fread(&rootcount, sizeof(int), 1, f) != 1 ||
+		rootcount < 0 || rootcount > (int)(sizeof(Roots)/sizeof(Roots[0]))) {
+		printf("[error] Bad image %s\n", file); fclose(f); return false;
+	}
+	if (top > MaxSize) {
+		printf("[error] Image %s needs %d cells. Increase the maximum memory size (--heap-max)\n", file, top);
+		fclose(f); return false;
+	}
+	FreeNames(); /// Those of Init
+	while (Size < top) Grow();
+	addr roots[sizeof(Roots)/sizeof(Roots[0])];
+	bool ok = fread(roots, sizeof(addr), rootcount, f) == (size_t)rootcount;
+	ok = ok && fread(Mem, sizeof(MemoryCell), top, f) == top;
+	ok = ok && fread(Type, 1, top, f) == top;
+	free(Obarray);
+	ObarraySize  = obsize;
+	ObarrayCount = obcount;
+	Obarray = (addr *) calloc(ObarraySize, sizeof(addr));
+	ok = ok && fread(Obarray, sizeof(addr), ObarraySize, f) == ObarraySize;
+	for (addr i = 0; ok && i < ObarraySize; i++) {
+		if (!Obarray[i]) continue;
+		int len;
+		ok = fread(&len, sizeof(int), 1, f) == 1 && len >= 0;
+		SymbolRecord *r = NewRecord(ok ? len : 0);
+		ok = ok && fread(&r->func, sizeof(int), 1, f) == 1 && fread(r->name, 1, len, f) == (size_t)len;
+		r->name[ok ? len : 0] = '\0';
+		r->code = NULL;
+		r->global = r->defun = 0;
+		r->traced = false;
+		Mem[Obarray[i]].sym = r;
+	}
+	fclose(f);
+	if (!ok) { printf("[error] Truncated image %s\n", file); exit(1); } /// Memory is half replaced already
+	for (int i = 0; i < rootcount && i < RootCount; i++) *Roots[i] = roots[i]; /// Not those of the REPL
+	memset(Type+top, 0, Top > top ? Top-top : 0);
+	memset(Marks, 0, Top/8+1);
+	Top       = top;
+	FreeList  = 0;
+	UsedCells = 0;
+	for (addr i = Top-1; i > 0; i--) {
+		if (!Type[i]) { Mem[i].cdr = FreeList; FreeList = i; }
+		else {
+			UsedCells++;
+			if (GCMode == GC_GENERATIONAL) SetMark(i); /// Old, so that the write barrier records them
+		}
+	}
+	LazyAt = LazyEnd = 0;
+	NurseryCount = 0;
+	RelinkSymbols();
+	AdaptTrigger(UsedCells);
+	printf("Image %s loaded: %d cells in use\n", file, UsedCells);
+	return true;
+}
+
+void MemoryClass::SetGlobal(addr symbol, addr value) {
+	addr pair = Mem[symbol].sym->global;
+	if (pair) SetCdr(pair, value);
+	else Mem[symbol].sym->global = Append(DEFVARS, &DefvarsLast, symbol, value);
+}
+
+void MemoryClass::SetDefun(addr symbol, addr lambda) {
+	addr pair = Mem[symbol].sym->defun;
+	if (pair) SetCdr(pair, lambda);
+	else Mem[symbol].sym->defun = Append(DEFUNS, &DefunsLast, symbol, lambda);
+}
+
+addr MemoryClass::Append(addr list, addr *last, addr symbol, addr value) {
+	addr pair = CreateCell(symbol, value);
+	if (!*last) { SetCar(list, pair); SetCdr(list, NILCELL); *last = list; }
+	else {
+		addr node = CreateCell(pair, NILCELL);
+		SetCdr(*last, node);
+		*last = node;
+	}
+	return pair;
+}
+
+void MemoryClass::RelinkSymbols() {
+	for (addr i = 0; i < ObarraySize; i++)
+		if (Obarray[i]) { Mem[Obarray[i]].sym->global = Mem[Obarray[i]].sym->defun = 0; Mem[Obarray[i]].sym->traced = false; }
+	DefvarsLast = DefunsLast = 0;
+	for (addr node = DEFVARS; Mem[DEFVARS].car && node != NILCELL; node = Mem[node].cdr) {
+		Mem[Mem[Mem[node].car].car].sym->global = Mem[node].car;
+		DefvarsLast = node;
+	}
+	for (addr node = DEFUNS; Mem[DEFUNS].car && node != NILCELL; node = Mem[node].cdr) {
+		Mem[Mem[Mem[node].car].car].sym->defun = Mem[node].car;
+		DefunsLast = node;
+	}
+	for (addr node = TRACEDFUNCS; Mem[TRACEDFUNCS].car && node != NILCELL; node = Mem[node].cdr)
+		Mem[Mem[Mem[node].car].car].sym->traced = true;
+}
+
+void MemoryClass::AddRoot(addr *root) {
+	if (RootCount == sizeof(Roots)/sizeof(Roots[0])) { printf("[error] Too many memory roots\n"); exit(1); }
+	Roots[RootCount++] = root;
+}
+
+void MemoryClass::SafePoint() {
+	RootStackTop = 0; /// Anything left protected is not held anymore
+	if (GCMode == GC_COPYING && GCNumberDone > GCsAtCompaction) Compact();
+}
+
+void MemoryClass::GrowRootStack() {
+	RootStackSize *= 2;
+	RootStack = (addr *) realloc(RootStack, RootStackSize*sizeof(addr));
+}
+
+void MemoryClass::MarkRoots() {
+	for (int i = 0; i < RootCount; i++) Mark(*Roots[i]);
+	for (addr i = 0; i < RootStackTop; i++) Mark(RootStack[i]);
+}
+
+void MemoryClass::Compact() {
+	long u0 = Micros();
+	long m0 = Millis();
+	addr oldTop = Top;
+	Forward = (addr *)       calloc(Top, sizeof(addr));
+	ToMem   = (MemoryCell *) malloc((long)Top*sizeof(MemoryCell));
+	ToType  = (char *)       malloc(Top);
+	ToTop   = TCELL+1;
+	for (int i = 0; i < RootCount; i++) *Roots[i] = Evacuate(*Roots[i]);
+	for (addr i = 0; i < RootStackTop; i++) RootStack[i] = Evacuate(RootStack[i]);
+	for (addr i = 0; i < ObarraySize; i++) if (Obarray[i]) Obarray[i] = Evacuate(Obarray[i]); /// Symbols are never gc'ed
+	for (addr scan = TCELL+1; scan < ToTop; scan++) { /// Copied cells still point to old addresses until scanned
+		if (ToType[scan] != 'C' || ToMem[scan].car == 0) continue;
+		ToMem[scan].car = Evacuate(ToMem[scan].car);
+		ToMem[scan].cdr = Evacuate(ToMem[scan].cdr);
+	}
+	memcpy(Mem+TCELL+1,  ToMem+TCELL+1,  (long)(ToTop-TCELL-1)*sizeof(MemoryCell));
+	memcpy(Type+TCELL+1, ToType+TCELL+1, ToTop-TCELL-1);
+	memset(Type+ToTop, 0, oldTop-ToTop);
+	ClearMarks(LazyAt, LazyEnd); /// Marks of cells not swept yet would be wrong at the new addresses
+	LazyAt = LazyEnd = 0;
+	free(Forward); free(ToMem); free(ToType);
+	Top       = ToTop;
+	FreeList  = 0;	/// All available cells are above Top now
+	UsedCells = Top-1;
+	RelinkSymbols();
+	GCCompactions++;
+	GCsAtCompaction = GCNumberDone;
+	long ms = Millis()-m0; if (ms > 0) GCTimeSpent += ms;
+	printf("[   gc] Compacted %d cells in %ld ms\n", UsedCells, ms);
+	long us = Micros()-u0; if (us > GCMaxPause) GCMaxPause = us;
+}
+
+addr MemoryClass::Evacuate(addr c) {
+	/// Copies c, unless already copied, followed by the rest of its cdr chain. Returns the new address of c
+	if (ISFIXNUM(c) || c <= TCELL || c >= Top) return c; /// Not a cell, or a cell that does not move
+	if (Forward[c]) return Forward[c];
+	addr result = ToTop;
+	while (true) {
+		Forward[c] = ToTop;
+		ToMem[ToTop]  = Mem[c];
+		ToType[ToTop] = Type[c];
+		ToTop++;
+		if (Type[c] != 'C' || Mem[c].car == 0) break;
+		c = Mem[c].cdr;
+		if (ISFIXNUM(c) || c <= TCELL || c >= Top || Forward[c]) break;
+	}
+	return result;
 }
 
 bool MemoryClass::IsNumber(char *v) {
@@ -161,43 +694,296 @@ bool MemoryClass::IsNumber(char *v) {
 long MemoryClass::Millis() {
 	struct timespec spec;
 	clock_gettime(CLOCK_REALTIME, &spec);
-    time_t secs = spec.tv_sec;
-    long ms = spec.tv_nsec / 1.0e6; /// Convert nanoseconds to milliseconds
-    return ms;
+    return spec.tv_sec*1000L + spec.tv_nsec/1000000; /// Not just the milliseconds within the current second
+}
+
+long MemoryClass::Micros() {
+	struct timespec spec;
+	clock_gettime(CLOCK_MONOTONIC, &spec);
+	return spec.tv_sec*1000000L + spec.tv_nsec/1000;
 }
 
 void MemoryClass::Mark(addr memaddr) {
-	if (Mem[memaddr].mark) return;
-	GCConsesMarked++;
-	Mem[memaddr].mark = true;
-	if (Mem[memaddr].type == 'C') {
-		if ((Mem[memaddr].car == 0 && Mem[memaddr].cdr != 0) || (Mem[memaddr].car != 0 && Mem[memaddr].cdr == 0)) {
-			printf("[   gc] Internal mem error at %d\n", memaddr);
-			return;
+	Gray(memaddr);
+	Trace(-1, 0);
+}
+
+void MemoryClass::Gray(addr c) {
+	if (MarkStackTop == MarkStackSize) {
+		MarkStackSize *= 2;
+		MarkStack = (addr *) realloc(MarkStack, MarkStackSize*sizeof(addr));
+	}
+	MarkStack[MarkStackTop++] = c;
+}
+
+bool MemoryClass::Trace(long budget, long t0) {
+	/// Iterative: cdr chains are followed in a loop and pending cars are kept in MarkStack,
+	/// so marking does not depend on the C stack however long or deep the lists are
+	long n = 0;
+	while (MarkStackTop > 0) {
+		addr c = MarkStack[--MarkStackTop];
+		while (true) {
+			if (budget >= 0 && (++n & 255) == 0 && Micros()-t0 >= budget) { Gray(c); return false; }
+			if (ISFIXNUM(c)) break; /// Not a cell
+			if (IsMarked(c)) break;
+			if (!Type[c]) break; /// Available: its cdr is a free list link, not a live sexpr
+			GCConsesMarked++;
+			SetMark(c);
+			if (Type[c] != 'C') break;
+			if ((Mem[c].car == 0 && Mem[c].cdr != 0) || (Mem[c].car != 0 && Mem[c].cdr == 0)) {
+				printf("[   gc] Internal mem error at %d\n", c);
+				break;
+			}
+			if (Mem[c].car == 0) break; /// NIL or an empty list head
+			Gray(Mem[c].car);
+			c = Mem[c].cdr;
+		}
+	}
+	return true;
+}
+
+void MemoryClass::ParallelMark() {
+	if (!Workers) { /// Started at the first gc, they wait for the next ones afterwards
+		Workers = (MarkWorker *) calloc(GCThreads, sizeof(MarkWorker));
+		pthread_mutex_init(&WorkersLock, 0);
+		pthread_cond_init(&WorkersStart, 0);
+		pthread_cond_init(&WorkersDone, 0);
+		WorkersEpoch = 0;
+		for (int w = 0; w < GCThreads; w++) {
+			Workers[w].size  = 1024;
+			Workers[w].deque = (addr *) malloc(Workers[w].size*sizeof(addr));
+			Workers[w].stacksize = 1024;
+			Workers[w].stack = (addr *) malloc(Workers[w].stacksize*sizeof(addr));
+			pthread_mutex_init(&Workers[w].lock, 0);
+			if (w > 0) pthread_create(&Workers[w].thread, 0, WorkerMain, (void *)(long)w); /// Thread 0 is this one
+		}
+	}
+	for (int w = 0; w < GCThreads; w++) Workers[w].bottom = Workers[w].top = Workers[w].marked = 0;
+	for (int i = 0; i < RootCount; i++) DequePush(Workers[i % GCThreads], *Roots[i]);
+	for (addr i = 0; i < RootStackTop; i++) DequePush(Workers[i % GCThreads], RootStack[i]);
+	WorkersIdle = 0;
+	pthread_mutex_lock(&WorkersLock);
+	WorkersFinished = 0;
+	WorkersEpoch++;
+	pthread_cond_broadcast(&WorkersStart);
+	pthread_mutex_unlock(&WorkersLock);
+	MarkShare(0);
+	pthread_mutex_lock(&WorkersLock);
+	while (WorkersFinished < GCThreads-1) pthread_cond_wait(&WorkersDone, &WorkersLock);
+	pthread_mutex_unlock(&WorkersLock);
+	for (int w = 0; w < GCThreads; w++) GCConsesMarked += Workers[w].marked;
+}
+
+void *MemoryClass::WorkerMain(void *arg) {
+	int w = (int)(long)arg;
+	int epoch = 0;
+	for (;;) {
+		pthread_mutex_lock(&Memory.WorkersLock);
+		while (Memory.WorkersEpoch == epoch) pthread_cond_wait(&Memory.WorkersStart, &Memory.WorkersLock);
+		epoch = Memory.WorkersEpoch;
+		pthread_mutex_unlock(&Memory.WorkersLock);
+		Memory.MarkShare(w);
+		pthread_mutex_lock(&Memory.WorkersLock);
+		Memory.WorkersFinished++;
+		pthread_cond_signal(&Memory.WorkersDone);
+		pthread_mutex_unlock(&Memory.WorkersLock);
+	}
+	return 0;
+}
+
+void MemoryClass::MarkShare(int w) {
+	/// As Trace, but cars pending to be marked go to the thread's deque, where other threads can steal them
+	MarkWorker &me = Workers[w];
+	me.stacktop = 0;
+	addr c;
+	for (;;) {
+		if (me.stacktop > 0) c = me.stack[--me.stacktop];
+		else if (!DequePop(me, c) && !Steal(w, c)) {
+			/// Only a thread with work pushes work, so once all threads are out of work marking is over
+			__atomic_add_fetch(&WorkersIdle, 1, __ATOMIC_SEQ_CST);
+			while (true) {
+				if (__atomic_load_n(&WorkersIdle, __ATOMIC_SEQ_CST) == GCThreads) return;
+				if (AnyWork()) { __atomic_sub_fetch(&WorkersIdle, 1, __ATOMIC_SEQ_CST); break; }
+				sched_yield();
+			}
+			continue;
+		}
+		while (true) {
+			if (ISFIXNUM(c)) break; /// Not a cell
+			if (!Type[c]) break; /// Available: its cdr is a free list link, not a live sexpr
+			unsigned char bit = 1 << (c&7);
+			if (__atomic_fetch_or(&Marks[c>>3], bit, __ATOMIC_RELAXED) & bit) break; /// Marked already, maybe by another thread
+			me.marked++;
+			if (Type[c] != 'C') break;
+			if (Mem[c].car == 0) break; /// NIL or an empty list head
+			if (me.stacktop == me.stacksize) {
+				me.stacksize *= 2;
+				me.stack = (addr *) realloc(me.stack, me.stacksize*sizeof(addr));
+			}
+			me.stack[me.stacktop++] = Mem[c].car;
+			c = Mem[c].cdr;
+		}
+		if (me.stacktop >= 16 && __atomic_load_n(&me.top, __ATOMIC_SEQ_CST) == __atomic_load_n(&me.bottom, __ATOMIC_SEQ_CST)) {
+			long n = me.stacktop/2; /// Shares the older half: others may be out of work
+			for (long i = 0; i < n; i++) DequePush(me, me.stack[i]);
+			memmove(me.stack, me.stack+n, (me.stacktop-n)*sizeof(addr));
+			me.stacktop -= n;
 		}
-		if (IsNIL(memaddr)) return;
-		Mark(Mem[memaddr].car);
-		Mark(Mem[memaddr].cdr);
 	}
 }
 
+void MemoryClass::DequePush(MarkWorker &d, addr c) {
+	pthread_mutex_lock(&d.lock);
+	if (d.top == d.size) {
+		if (d.bottom > 0) { /// Reuse the room left by steals
+			memmove(d.deque, d.deque+d.bottom, (d.top-d.bottom)*sizeof(addr));
+			d.top -= d.bottom; d.bottom = 0;
+		}
+		else {
+			d.size *= 2;
+			d.deque = (addr *) realloc(d.deque, d.size*sizeof(addr));
+		}
+	}
+	d.deque[d.top++] = c;
+	pthread_mutex_unlock(&d.lock);
+}
+
+bool MemoryClass::DequePop(MarkWorker &d, addr &c) {
+	pthread_mutex_lock(&d.lock);
+	bool found = d.top > d.bottom;
+	if (found) c = d.deque[--d.top];
+	if (d.top == d.bottom) d.top = d.bottom = 0;
+	pthread_mutex_unlock(&d.lock);
+	return found;
+}
+
+bool MemoryClass::Steal(int w, addr &c) {
+	for (int i = 1; i < GCThreads; i++) {
+		MarkWorker &d = Workers[(w+i) % GCThreads];
+		pthread_mutex_lock(&d.lock);
+		bool found = d.top > d.bottom;
+		if (found) c = d.deque[d.bottom++]; /// The oldest: likely the largest subgraph left
+		pthread_mutex_unlock(&d.lock);
+		if (found) return true;
+	}
+	return false;
+}
+
+bool MemoryClass::AnyWork() {
+	for (int w = 0; w < GCThreads; w++)
+		if (__atomic_load_n(&Workers[w].top, __ATOMIC_SEQ_CST) > __atomic_load_n(&Workers[w].bottom, __ATOMIC_SEQ_CST)) return true;
+	return false;
+}
+
+void MemoryClass::LazySweep() {
+	addr last;
+	while (FreeList == 0 && LazyAt < LazyEnd) {
+		addr to = (LazyEnd-LazyAt > SWEEPCHUNK) ? (LazyAt+SWEEPCHUNK) & ~7 : LazyEnd; /// Chunks end at a mark byte boundary
+		FreeList = SweepChunk(LazyAt, to, &last);
+		LazyAt = to;
+	}
+}
+
+addr MemoryClass::SweepChunk(addr from, addr to, addr *last) {
+	addr chain = 0;
+	for (addr i = to-1; i >= from; i--) { /// Downwards, so that the chain is in increasing address order
+		if (Type[i] && !IsMarked(i)) { Type[i] = 0; Poison(i); }
+		if (!Type[i]) {
+			if (!chain) *last = i;
+			Mem[i].cdr = chain; chain = i;
+		}
+	}
+	ClearMarks(from, to);
+	return chain;
+}
+
+void MemoryClass::StartSweeper() {
+	if (!SweeperStarted) { /// Started at the first gc, it waits for the next ones afterwards
+		pthread_mutex_init(&SweeperLock, 0);
+		pthread_cond_init(&SweeperStart, 0);
+		pthread_cond_init(&SweeperDone, 0);
+		SweeperEpoch = 0;
+		pthread_create(&Sweeper, 0, SweeperMain, 0);
+		SweeperStarted = true;
+	}
+	pthread_mutex_lock(&SweeperLock);
+	SweeperEnd = Top;
+	Sweeping   = true;
+	SweeperEpoch++;
+	pthread_cond_signal(&SweeperStart);
+	pthread_mutex_unlock(&SweeperLock);
+}
+
+void *MemoryClass::SweeperMain(void *arg) {
+	int epoch = 0;
+	for (;;) {
+		pthread_mutex_lock(&Memory.SweeperLock);
+		while (Memory.SweeperEpoch == epoch) pthread_cond_wait(&Memory.SweeperStart, &Memory.SweeperLock);
+		epoch = Memory.SweeperEpoch;
+		pthread_mutex_unlock(&Memory.SweeperLock);
+		addr end = Memory.SweeperEnd;
+		for (addr from = TCELL+1, to; from < end; from = to) {
+			to = (end-from > SWEEPCHUNK) ? (from+SWEEPCHUNK) & ~7 : end; /// Chunks end at a mark byte boundary
+			addr last;
+			addr chain = Memory.SweepChunk(from, to, &last);
+			if (!chain) continue;
+			pthread_mutex_lock(&Memory.SweeperLock);
+			if (Memory.SweptTail) Memory.Mem[Memory.SweptTail].cdr = chain;
+			else __atomic_store_n(&Memory.SweptHead, chain, __ATOMIC_RELEASE);
+			Memory.SweptTail = last;
+			pthread_cond_broadcast(&Memory.SweeperDone);
+			pthread_mutex_unlock(&Memory.SweeperLock);
+		}
+		pthread_mutex_lock(&Memory.SweeperLock);
+		__atomic_store_n(&Memory.Sweeping, false, __ATOMIC_RELEASE);
+		pthread_cond_broadcast(&Memory.SweeperDone);
+		pthread_mutex_unlock(&Memory.SweeperLock);
+	}
+	return 0;
+}
+
+void MemoryClass::WaitSweeper() {
+	if (!SweeperStarted) return;
+	pthread_mutex_lock(&SweeperLock);
+	while (Sweeping) pthread_cond_wait(&SweeperDone, &SweeperLock);
+	SweptHead = SweptTail = 0; /// Gc chains available cells again
+	pthread_mutex_unlock(&SweeperLock);
+}
+
+void MemoryClass::TakeSwept(bool wait) {
+	pthread_mutex_lock(&SweeperLock);
+	while (wait && !SweptHead && Sweeping) pthread_cond_wait(&SweeperDone, &SweeperLock);
+	FreeList  = SweptHead;
+	SweptHead = SweptTail = 0;
+	pthread_mutex_unlock(&SweeperLock);
+}
+
+void MemoryClass::ClearMarks(addr from, addr to) {
+	/// Whole bytes of the bitmap: cells next to the range are either swept already or have no mark
+	if (from < to) memset(Marks+(from>>3), 0, ((to-1)>>3)-(from>>3)+1);
+}
+
 void MemoryClass::Sweep() {
 	addr freed = 0;
-	for (int i = 0; i < MEMSIZE; i++) {
-		if (!Mem[i].mark && !Mem[i].available) {
-			if (Mem[i].type == 'S') free (Mem[i].name);
-			Mem[i].available = true;
+	FreeList = 0;
+	for (addr i = Top-1; i > TCELL; i--) { /// Downwards, so that the free list is in increasing address order. NIL and T are kept
+		if (Type[i] && Type[i] != 'S' && !IsMarked(i)) { /// Symbols stay in Obarray
+			Type[i] = 0; Poison(i);
 			freed++;
 		}
-		Mem[i].mark = false;
+		if (!Type[i]) { Mem[i].cdr = FreeList; FreeList = i; }
 	}
+	NurseryCount = 0; /// Marked cells are old now. Start a new nursery
+	for (addr i = 0; i < RememberedCount; i++) RememberedBits[Remembered[i]>>3] = 0;
+	RememberedCount = 0;
 	UsedCells -= freed;
 	GCConsesFreed += freed;
 }
 
 void MemoryClass::CheckEndOfMemory() {
-	if (MemIx == MEMSIZE) { 
-		printf("\nMemory exhausted.\nIncrease MEMSIZE or decrease PCT_TRIGGER_GC.\nExiting.\n"); 
+	if (FreeList == 0 && Top == Size && __atomic_load_n(&Sweeping, __ATOMIC_ACQUIRE)) TakeSwept(true); /// Rather than growing
+	if (FreeList == 0 && Top == Size && !Grow()) { 
+		printf("\nMemory exhausted.\nIncrease the maximum memory size (--heap-max).\nExiting.\n"); 
 		exit(0); 
 	}
 }
@@ -1,146 +1,453 @@
 #pragma once
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
 /**
- * The memory model consists of an array of the MemoryCell struct. This is not optimized for storage
- * usage but provides a clear view of the memory model. Memory is consumed solely by calls to the
- * overloaded CreateCell function, which scans the memory space looking for the next available memory
- * cell.
- * 
- * MEMSIZE defines the maximum size of the memory:
- * 		- The first address is at 1 so that address 0 is never reachable and can be used to 
- * 		  represent NIL by a cons(0,0).
- * 		- There are some addresses above MEMSIZE that are used to represent unique addr values
+ * The memory model consists of an array of the MemoryCell union, 8 bytes each: a number, a symbol record
+ * pointer or a car/cdr pair of addresses. The type of each cell is kept apart in the Type byte array,
+ * where 0 means an available cell, and gc marks are kept in the Marks bitmap. Keeping these out of
+ * the cells halves the size of Mem, so twice as many cells fit in cache while marking or walking lists.
+ * Memory is consumed solely by calls to the overloaded CreateCell function, which pops the next available
+ * memory cell from a free list.
+ * 
+ * The memory has Size cells, given at startup (see main) and MEMSIZE by default:
+ * 		- The first address is at 1 so that address 0 is never reachable and can be used as the car
+ * 		  and cdr of an empty list, a cons(0,0).
+ * 		- Room for MaxSize cells is reserved at startup as virtual memory, which the system only backs
+ * 		  with real memory as it gets used. Cells at or above Top have never been used yet, so a small
+ * 		  workload only touches the memory it needs.
+ * 		- When the gc policy (see below) needs more room, Size is doubled (up to MaxSize).
+ * 		  As the reserved memory never moves, addresses stay valid when the memory grows. Memory is only
+ * 		  exhausted when MaxSize is reached.
+ * 		- There are some addresses above MEMMAXSIZE that are used to represent unique addr values
  *   	  to represent special statuses or conditions, facilitating the writing of some functions.
  * 
  * Atoms are represented by memory cells of type S (symbols) or N (numbers). Lists are represented
- * by linked memory cells of type C (cons). The end of a list is marked with a cons(0,0). An empty
- * list item is represented by cons(0,0). In other words, a cons(0,0) in the car of a cons represents
- * an empty list, a cons(0,0) in the cdr of a cons represents the end of the list. Examples (lower case
- * letters represent addresses):
+ * by linked memory cells of type C (cons). NIL is a single cons(0,0) living at address NILCELL, which
+ * is both the empty list and the end of list marker. Likewise, T is a single symbol living at address
+ * TCELL. Both are created by Init and never gc'ed, so that _NIL_ and _T_ do not consume memory and
+ * ISNIL is just an address comparison. Examples (lower case letters represent addresses):
  * 
  * 		List at addr L: (S1 S2 S3)
  * 
- * 		   L ---> cons(a,b) ---> b:cons(c,d) ---> d:cons(e,f) ---> f:cons(0,0)
+ * 		   L ---> cons(a,b) ---> b:cons(c,d) ---> d:cons(e,NIL)
  *                     V                V                V
  * 					   a:symbol(S1)     c:symbol(S2)     e:symbol(S3)
  * 
  * 		List at addr L: (S1 () S2)
  *
- * 		   L ---> cons(a,b) ---> b:cons(c,d) ---> d:cons(e,f) ---> f:cons(0,0)
- *                     V                V                V
- * 					   a:symbol(S1)     c:cons(0,0)      e:symbol(S2)
+ * 		   L ---> cons(a,b) ---> b:cons(NIL,d) ---> d:cons(e,NIL)
+ *                     V                                  V
+ * 					   a:symbol(S1)                       e:symbol(S2)
  * 
  * 		List at addr L: ()
  * 
- * 		   L ---> cons(0,0)
+ * 		   L = NIL
  * 
  * 		List at addr L: (())
  * 
- * 		   L ---> cons(a,b) ---> f:cons(0,0)
- *                     V        
- * 					   a:cons(0,0)
+ * 		   L ---> cons(NIL,NIL)
+ * 
+ * Small integers are not stored in cells: they are immediate fixnums encoded in the addr value itself,
+ * with the FIXNUMTAG bit set and a 31 bit signed value in the rest (see ISFIXNUM). TYPE of a fixnum is
+ * 'N' and VALUE decodes it, so most code does not need to tell them apart from numbers living in 'N'
+ * cells, which are only created for values that don't fit. Arithmetic and counting loops thus create no
+ * cells at all. As with cells, numbers are never modified in place, so a number can be shared freely.
  * 
- * As a design principle, a pointer to a cons(0,0) could have been substituted by the value 0 as long as
- * memory cells start to be consumed at index 1 (which is the case), but consuming this extra cell facilitates
- * to some extent the writing of some functions across the interpreter.
+ * Symbols are interned: the symbol table (Obarray) holds a single symbol cell for each distinct name, 
+ * compared case insensitively, so symbols can be compared by address. The name keeps the spelling it had
+ * when first read. Symbol cells are never gc'ed. The reader turns the symbol nil into NIL.
+ * A symbol cell points to its SymbolRecord, which holds the name and the index of the builtin function
+ * it names (FUNC, set by LispClass::Init), so that Eval dispatches builtins with no string compares, and the
+ * compiled code of the function it names, if any (CODE, not saved in images).
+ * The record also points to the symbol's pair in DEFVARS (GLOBAL) and in DEFUNS (DEFUN), so that global
+ * variables are shallow bound and defuned functions are found with no assoc list walk. Both lists are kept,
+ * in order of definition, as the lists that gc marks and do-symbols iterates; SetGlobal and SetDefun keep them
+ * in step with the records, and RelinkSymbols rebuilds the pointers when Compact or LoadImage move the cells.
+ * Likewise, TRACED caches whether the symbol is in TRACEDFUNCS, so that untraced calls pay no lookup for it.
+ * Records are not malloc'ed one by one: they are copied into a chain of NAMEBLOCK byte blocks (the name
+ * arena) by bumping a pointer, and the blocks are only freed all at once, when an image replaces them.
+ * 
+ * NIL can't be modified, so lists that are built in place (by the Push, Extend and AssocListSet functions
+ * of the interpreter) must start from a new cons(0,0) obtained with _NEWLIST_. Such a list head is empty
+ * while its car is 0, which is checked with ISEMPTY. Note that a list head becomes empty again when its
+ * last item is popped. Only lists ending in NIL are handed over to Lisp code.
  * 
  * On memory initialization, some important lists are created:
  * 		DEFVARS, to hold global variables
  *  	DEFUNS, to hold the defuned functions
- * 		GCSAFE, to hold conses that must survive the gc process.
  * 		RETURNS, to hold a stack for the management of the Lisp (return) function
  * 		TRACEDFUNCS, to hold the list of defuned functions which are marked to be traced via (trace)
+ * It also interns LOCALREF, the symbol heading the local references that the interpreter puts in defun bodies
+ * (see LispClass::Resolve). Its name has a space, so the reader can't produce it, and Print shows a local
+ * reference as the symbol it stands for.
+ * 
+ * The garbage collection approach is based on a simple Mark/Seep algorithm. Sexprs held by C code that need
+ * to be safe from gc are kept in the RootStack array with Protect, and dropped with Unprotect in reverse order.
+ * That is a single store, with no cell created. At Mark time all conses in the above mentioned lists and in
+ * RootStack are marked to be kept, as well as all symbols and NIL. Sweep is lazy: gc only marks, and then CreateCell
+ * sweeps the memory SWEEPCHUNK cells at a time whenever the free list runs out, setting the conses not marked
+ * to available and clearing the marks as it goes. So a gc pause is just the mark time, and memory that is
+ * mostly live costs little to sweep. The number of cells in use is known right after marking, as everything
+ * else is garbage. Mark is not recursive: it walks along cdrs and keeps the cars still to be visited in its
+ * own stack, so that gc works on lists of any length.
+ * 
+ * With --gc generational, gc is generational: cells that survive a gc become old and keep their mark bit
+ * set afterwards. Cells created since the last gc (the nursery, logged in Nursery) are young. Most of them
+ * die young, so when NURSERYSIZE cells have been created a minor gc is done: it only marks young cells and
+ * only sweeps the nursery. A full gc is only done when GCTrigger is reached. For this to work, an old
+ * cell pointing to a young one must be known to the minor gc: every change of the car or cdr of an existing
+ * cell goes through SETCAR and SETCDR, whose write barrier records mutated old cells in the Remembered set.
+ * Minor gcs mark starting from them, as well as from the roots.
+ * 
+ * When a gc is due is set by an adaptive policy, instead of a fixed percentage of memory in use. After each
+ * full gc, the next one is set (GCTrigger) for when the cells in use have grown by GCGrowth percent of the
+ * live ones, so the gc work per cell created stays the same however much is live, and never before GCMaxFill
+ * percent of the memory is used. Should that exceed GCMaxFill, memory grows. Memory also grows when the
+ * survival rate of recent gcs (GCSurvival, averaged) is above GCHighSurvival, as gc would free little. When
+ * memory can't grow anymore, the next gc is set halfway through the memory still available, rather than at
+ * once. The parameters can be set from Lisp with (gc-policy), and (room) shows them.
  * 
- * The garbage collection approach is based on a simple Mark/Seep algorithm. Sexprs that need to be
- * safe from gc should be kept in the _GCSAFE_ list. At Mark time all conses in the above mentioned lists
- * are marked to be kept. At Sweep time, those conses not marked are set to available. MemIx is reset to 1
- * to start exploring available memory space in sequence.
+ * With --gc-threads n, full gcs mark in parallel with n threads (the REPL thread and n-1 workers started at
+ * the first gc). Each thread has a MarkWorker deque of cells to be marked, among which the roots are dealt
+ * out. A thread walking cdr chains keeps pending cars in its own stack, and moves the older half of them to
+ * its deque whenever the deque is empty. A thread out of work takes from its deque or steals from the bottom
+ * of another's deque, where the cells whose subgraphs are yet to be walked sit. Mark
+ * bits are set with an atomic or, so that each cell is marked by one thread only. Marking ends when all the
+ * threads are out of work. Minor and incremental gcs mark in a single thread. Parallel marking is opt-in:
+ * on the heaps measured so far, the workers' spinning and deque locking cost more than they saved.
+ * 
+ * With --gc incremental, gc is done in slices of at most GCPauseBudget microseconds (--gc-pause), so that
+ * no gc pause is long. A gc cycle starts at GCThreshold (60% memory use, with the default 80% GCTrigger),
+ * pushing the roots on the mark stack.
+ * Then a slice is done every GCSLICEALLOC cells created: it marks from the mark stack until it is empty, and
+ * then sweeps a part of the memory, until all of it is swept. As the program runs between slices, marking is
+ * snapshot at the beginning: while marking, SETCAR and SETCDR push the value they overwrite on the mark stack,
+ * and new cells are created marked. So everything reachable when the cycle started, or created since, is
+ * kept. While sweeping, cells created in the part not swept yet are created marked too. Should memory reach
+ * GCTrigger during a cycle, the slice finishes the cycle, as gc is not keeping up.
+ * 
+ * With --gc background, memory is swept by a thread of its own instead of lazily, so the program only waits
+ * for marking. The sweeper hands the available cells over chunk by chunk in the Swept list, which CreateCell
+ * takes when its free list runs out. Meanwhile cells are taken from Top, and only if memory is used up up to
+ * Size does CreateCell wait for the sweeper. The sweeper only writes the type and cdr of cells not marked,
+ * which the program can't reach, and the marks, which the program does not use in this mode. The next gc
+ * waits for the sweeper to finish before marking.
+ * 
+ * With --gc copying, gc is mark/sweep as above, but memory is also compacted with Compact: live cells are
+ * copied Cheney style to the bottom of the memory, each cdr chain laid out in consecutive cells, so that
+ * walking a list touches consecutive memory again after gcs have scattered its cells. As cells move, all
+ * addresses held outside Mem must be updated: those are the roots registered with AddRoot and Obarray.
+ * Addresses held in C locals can't be updated, so compaction is only done at SafePoint, which the REPL
+ * calls between top level forms, when a gc has been done since the last compaction. NIL and T never move.
+ * 
+ * The whole memory can be saved to an image file with SaveImage, and restored at startup with LoadImage
+ * (--image), which is much faster than loading the Lisp sources again. The image holds the cells up to Top
+ * and their types, read back in a single bulk read each, the registered roots, Obarray and the symbol records,
+ * as the record pointers in symbol cells are not valid in another process. The free list is rebuilt on loading.
+ * 
+ * Available cells are chained in a free list through their cdr field, so that CreateCell takes constant
+ * time no matter how full the memory is. Each chunk is swept downwards, so that cells keep being handed
+ * out in increasing address order.
+ * 
+ * The debug build (make debug, which defines DEBUGMEM) checks that CAR, CDR and VALUE are never used on a
+ * free cell, nor on garbage left for a lazy or incremental sweep, and aborts if they are. Swept cells are
+ * also poisoned: their car is set to DEADCELL, past any memory, so that code reading Mem directly from a
+ * freed cell can't go on as if it were a cons.
  */
 
-#define MEMSIZE 		1000000		/** Number of memory cells 										*/
-#define PCT_TRIGGER_GC	80			/** Percentage of MEMSIZE used to trigger garbage collection	*/
+#define MEMSIZE 		1000000		/** Default number of memory cells 								*/
+#define MEMMAXSIZE		(1 << 28)	/** Default maximum number of memory cells the memory can grow to	*/
+#define MEMLIMIT		0x7FFFFF00	/** Hard limit for the number of memory cells						*/
+#define DEADCELL		0x7FFFFFF0	/** Car of the freed cells in the debug build (DEBUGMEM)			*/
+#define PCT_TRIGGER_GC	80			/** Default GCMaxFill												*/
+#define PCT_GROWTH		100			/** Default GCGrowth												*/
+#define PCT_HIGHSURVIVAL 50			/** Default GCHighSurvival											*/
+#define NURSERYSIZE		65536		/** Cells created that trigger a minor gc in generational mode	*/
+#define PCT_START_INCGC	75			/** Percentage of the room up to GCTrigger used to start an incremental gc cycle */
+#define GCSLICEALLOC	4096		/** Cells created between incremental gc slices					*/
+#define GCPAUSEBUDGET	1000		/** Default incremental gc slice budget, in microseconds			*/
+#define MAXGCTHREADS	16			/** Maximum number of marking threads							*/
+#define NAMEBLOCK		65536		/** Bytes of each block of the symbol name arena					*/
+#define SWEEPCHUNK		4096		/** Cells swept at a time by the lazy sweep						*/
 
 /// Utility defines to access MemoryCells
-#define _NIL_			Memory.CreateCell(0,0)
-#define _T_				Memory.CreateCell((char *)"T")
+#define NILCELL			1			/** Address of NIL 											*/
+#define TCELL			2			/** Address of T 											*/
+#define _NIL_			NILCELL
+#define _T_				TCELL
+#define _NEWLIST_		Memory.CreateCell(0,0)	/// A new empty list head, to be built in place
 #define _DEFVARS_		Memory.DEFVARS
 #define _DEFUNS_		Memory.DEFUNS
-#define _GCSAFE_		Memory.GCSAFE
 #define _RETURNS_   	Memory.RETURNS
 #define _TRACEDFUNCS_	Memory.TRACEDFUNCS
-#define ISNIL(x)		Memory.IsNIL(x)
-#define TYPE(x)			Memory.Mem[x].type
-#define VALUE(x)		Memory.Mem[x].value
-#define NAME(x)			Memory.Mem[x].name
-#define CAR(x)			Memory.Mem[x].car
-#define CDR(x)			Memory.Mem[x].cdr
-#define USEDMEMPCT		((Memory.UsedCells*100)/MEMSIZE)
+#define _LOCALREF_		Memory.LOCALREF
+#define ISNIL(x)		((x) == _NIL_)
+#define ISEMPTY(x)		(CAR(x) == 0)	/// True for NIL and for an empty _NEWLIST_ (x must be a cons)
+#ifdef DEBUGMEM
+#define CELL(x)			Memory.Checked(x)	/// Mem[x] of a cell in use, as read by CAR, CDR and VALUE
+#else
+#define CELL(x)			Memory.Mem[x]
+#endif
+#define TYPE(x)			(ISFIXNUM(x) ? 'N' : Memory.Type[x])
+#define VALUE(x)		(ISFIXNUM(x) ? FIXNUMVALUE(x) : CELL(x).value)
+#define NAME(x)			Memory.Mem[x].sym->name
+#define FUNC(x)			Memory.Mem[x].sym->func	/// Builtin function index of symbol x, -1 if none
+#define CODE(x)			Memory.Mem[x].sym->code	/// Compiled code of symbol x, NULL if none
+#define GLOBAL(x)		Memory.Mem[x].sym->global	/// Global (symbol . value) pair of symbol x, 0 if none
+#define DEFUN(x)		Memory.Mem[x].sym->defun	/// Defun (symbol . lambda) pair of symbol x, 0 if none
+#define TRACED(x)		Memory.Mem[x].sym->traced	/// True if the defuned function named by symbol x is traced
+#define CAR(x)			CELL(x).car
+#define CDR(x)			CELL(x).cdr
+#define SETCAR(x,v)		Memory.SetCar(x,v)	/// Always use these to modify an existing cell
+#define SETCDR(x,v)		Memory.SetCdr(x,v)
+#define GCNEEDED		(Memory.UsedCells > Memory.GCThreshold || Memory.NurseryCount >= NURSERYSIZE || Memory.SliceCount >= GCSLICEALLOC)
+#define USEDMEMPCT		((int)(((long)Memory.UsedCells*100)/Memory.Size))
+
+typedef unsigned int addr;	/// Index on memory array, or an immediate fixnum
 
-typedef unsigned int addr;	/// Index on memory array 
+#define FIXNUMTAG		0x80000000	/** Tag bit of immediate fixnums								*/
+#define FIXNUMMIN		(-(1L << 30))
+#define FIXNUMMAX		((1L << 30) - 1)
+#define ISFIXNUM(x)		((x) & FIXNUMTAG)
+#define FIXNUM(v)		(((addr)(v) & ~FIXNUMTAG) | FIXNUMTAG)	/// v must be within FIXNUMMIN..FIXNUMMAX
+#define FIXNUMVALUE(x)	((long)((int)((x) << 1) >> 1))		/// Sign extends the 31 bit value
 
 /// These are utility hacks to ease the writing of some functions.
 /// They are used by functions using/returning addr to signal special conditions.
 /// Using this hacks avoids making the functions more complex by having to add extra parameters.
 /// This is better understood by analizing the context in which these defines are used.
-#define ENDOFLIST    	MEMSIZE+1
-#define ENDOFSEXPR   	MEMSIZE+2
-#define TRAVERSEMARK 	MEMSIZE+3
-#define RETURNMARK	 	MEMSIZE+4
-#define DONTUSEBINDINGS MEMSIZE+5
-
-struct MemoryCell {
-	bool available;
-	char type; 			/// (N)umber (S)ymbol (C)ons
-	bool mark;			/// Used in gc processing
-	union {
-		long value;		/// Case Number
-		char *name;		/// Case Symbol
-		struct {		/// Case Cons
-			addr car;
-			addr cdr;
-		};
-	 };
+#define ENDOFLIST    	MEMLIMIT+1
+#define ENDOFSEXPR   	MEMLIMIT+2
+#define TRAVERSEMARK 	MEMLIMIT+3
+#define RETURNMARK	 	MEMLIMIT+4
+
+enum GCModes { GC_MARKSWEEP, GC_GENERATIONAL, GC_COPYING, GC_INCREMENTAL, GC_BACKGROUND };
+enum GCPhases { GC_IDLE, GC_MARKING, GC_SWEEPING };	/// Of an incremental gc cycle
+
+struct MarkWorker {				/// A marking thread's work
+	pthread_t thread;
+	pthread_mutex_t lock;		/// Guards the deque
+	addr *deque;				/// Cells to be marked that can be stolen, from bottom to top-1
+	long size;
+	long bottom;
+	long top;
+	addr *stack;				/// Cells to be marked only by the owner, so no locking is needed
+	long stacksize;
+	long stacktop;
+	long marked;
+};
+
+struct SymbolRecord {
+	void *code;			/// Compiled code of the defuned function named by the symbol (see LispClass::Compiled)
+	addr global;		/// Its (symbol . value) pair in DEFVARS, 0 if the symbol has no global value
+	addr defun;			/// Its (symbol . lambda) pair in DEFUNS, 0 if the symbol names no defuned function
+	bool traced;		/// True while the symbol is in TRACEDFUNCS
+	int  func;			/// Index in LispClass::Func, -1 if not a builtin
+	char name[1];		/// Allocated to the length of the name
+};
+
+union MemoryCell {
+	long value;			/// Case Number
+	SymbolRecord *sym;	/// Case Symbol
+	struct {			/// Case Cons
+		addr car;
+		addr cdr;
+	};
 };
 
 class MemoryClass {
 public:
-	void Init();
+	void Init(addr size, addr maxsize);
 	addr CreateCell(addr car, addr cdr);
-	addr CreateCell(char *t);
-	addr CreateCell(long n);
+	addr CreateCell(char *t);	/// A number, or the interned symbol t
+	addr CreateCell(long n);	/// A fixnum, or an 'N' cell if n does not fit
+	addr Intern(const char *name);	/// The symbol cell for name, created if it did not exist
 	
-	void Print(addr sexpr);
+	void Print(addr sexpr, FILE *out=stdout);
 	void Dump();
-	bool IsNIL(addr);
+	bool SaveImage(const char *file);	/// False on error
+	bool LoadImage(const char *file);	/// Replaces the memory. False on error
 	
-	void GC(const char *msg);	/// Garbage collection
+	void GC(const char *msg, bool full = false);	/// Garbage collection. In generational mode, a minor one unless full
+	bool SetGCMode(const char *name);	/// False if there is no such mode
+	void Protect(addr x) {		/// Keeps x safe from gc until unprotected
+		if (RootStackTop == RootStackSize) GrowRootStack();
+		RootStack[RootStackTop++] = x;
+	}
+	void Unprotect(int n = 1) { RootStackTop -= n; }	/// The last n protected
+	addr &Protected(int i) { return RootStack[RootStackTop-1-i]; }	/// The i'th last protected, from 0
+	void AddRoot(addr *root);	/// An addr variable outside Mem to be kept alive by gc and updated by Compact
+	void SafePoint();			/// To be called only when no addr other than the roots is held by C code
+	void Compact();				/// Copying gc (copying mode)
 	
-	addr DEFVARS; 				/// Global symbol bindings (an assoc list)
-	addr DEFUNS;  				/// Defuns (an assoc list)
-	addr GCSAFE;  				/// GC safe stack (a list of sexpr). Sexprs in this list are not subject to gc
+#ifdef DEBUGMEM
+	MemoryCell &Checked(addr x) {	/// Mem[x], aborting if x is a fixnum, a free cell or garbage not swept yet
+		bool unswept = (x >= LazyAt && x < LazyEnd) || (GCPhase == GC_SWEEPING && x <= SweepAt);
+		if (ISFIXNUM(x) || (x > TCELL && x < Top && (!Type[x] || (unswept && Type[x] != 'S' && !IsMarked(x))))) {
+			printf("[error] Access to free cell %u\n", x); fflush(stdout); abort();
+		}
+		return Mem[x];
+	}
+	void Poison(addr c) { Mem[c].car = DEADCELL; }
+#else
+	void Poison(addr) {}
+#endif
+	void SetCar(addr c, addr v) { Barrier(c, Mem[c].car); Mem[c].car = v; }
+	void SetCdr(addr c, addr v) { Barrier(c, Mem[c].cdr); Mem[c].cdr = v; }
+	
+	addr DEFVARS; 				/// Global symbol bindings (an assoc list, each pair also pointed to by GLOBAL)
+	void SetGlobal(addr symbol, addr value);	/// Sets the global value of symbol, added to DEFVARS if new
+	addr DEFUNS;  				/// Defuns (an assoc list, each pair also pointed to by DEFUN)
+	void SetDefun(addr symbol, addr lambda);	/// Sets the function of symbol, added to DEFUNS if new
 	addr RETURNS;				/// Lisp (return) stack management
 	addr TRACEDFUNCS;			/// Defuned traced functions (an assoc list). The defuned functions that are marked to be traced
 								/// are kept in an assoc list in which the value is useless, but in this way the AssocList*
 								/// functions in the Lisp interpreter can be used to manage the traced functions.
+	addr LOCALREF;				/// Symbol heading local references: (LOCALREF depth/slot . symbol)
 	
-	MemoryCell Mem[MEMSIZE];
+	MemoryCell *Mem;
+	char *Type;					/// (N)umber (S)ymbol (C)ons, or 0 if available
+	addr Size;					/// Current number of cells
+	addr MaxSize;				/// Number of cells reserved
 	addr UsedCells;
 	int  GCNumberDone;			/// GC stats
 	long GCTimeSpent;			/// GC stats
 	long GCConsesFreed;			/// GC stats
 	long GCConsesMarked;		/// GC stats	
+	int  GCMinorDone;			/// GC stats
+	int  GCCompactions;			/// GC stats
+	long GCMaxPause;			/// GC stats: longest gc pause, in microseconds
+	
+	int  GCMode;				/// One of GCModes
+	addr NurseryCount;			/// Cells created since last gc (generational mode)
+	addr GCTrigger;				/// Cells in use that make a full gc due
+	addr GCThreshold;			/// Cells in use that make GCNEEDED: GCTrigger, or less to start an incremental cycle
+	int  GCGrowth;				/// GC policy: cells created between gcs, as a percentage of the live ones
+	int  GCMaxFill;				/// GC policy: highest percentage of memory used at which gc is due, before growing
+	int  GCHighSurvival;		/// GC policy: survival percentage over which memory grows
+	int  GCSurvival;			/// Survival percentage of recent full gcs
+	int  GCPhase;				/// One of GCPhases (incremental mode)
+	long GCPauseBudget;			/// Microseconds per slice (incremental mode)
+	int  GCThreads;				/// Threads marking in full gcs
+	addr SliceCount;			/// Cells created since last slice, while a cycle runs (incremental mode)
 
 	long Millis();				/// System milliseconds
+	long Micros();				/// System microseconds
 
 private:
-	addr MemIx;	
+	addr FreeList;				/// First available cell below Top, 0 if none
+	addr Top;					/// Cells from Top to Size have never been used
+	addr NewCell();				/// Pops a cell out of FreeList, or takes it from Top
+	bool Grow();				/// Doubles Size. False if MaxSize was already reached
+	void *Reserve(long bytes);
+	
+	addr *Obarray;				/// Symbol table: open addressing hash table of symbol cells (0 if free slot)
+	addr ObarraySize;			/// Number of slots, always a power of 2
+	addr ObarrayCount;			/// Number of symbols
+	addr Hash(const char *name);	/// Case insensitive hash
+	void ObarrayGrow();
+	addr DefvarsLast;			/// Last node of DEFVARS, 0 while it is empty (SetGlobal appends there)
+	addr DefunsLast;			/// Last node of DEFUNS, 0 while it is empty (SetDefun appends there)
+	addr Append(addr list, addr *last, addr symbol, addr value);	/// Adds a new (symbol . value) pair and returns it
+	void RelinkSymbols();		/// Sets GLOBAL, DEFUN and TRACED of every symbol, and the last nodes, from the lists
+	char *NameArena;			/// Current block of the name arena. Its first bytes point to the previous block
+	addr NameArenaUsed;			/// Bytes taken in the current block
+	addr NameArenaSize;			/// Bytes in the current block
+	SymbolRecord *NewRecord(int len);	/// Room for a record with a name of len chars, taken from the arena
+	void FreeNames();			/// Frees the whole arena
 	bool IsNumber(char *v);
 
+	unsigned char *Marks;		/// GC mark bitmap, one bit per cell
+	bool IsMarked(addr i) { return Marks[i>>3] & (1 << (i&7)); }
+	void SetMark(addr i)  { Marks[i>>3] |= (1 << (i&7)); }
+	
+	addr *MarkStack;			/// Cars pending to be marked, grown as needed
+	addr MarkStackSize;
+	addr MarkStackTop;
+	void Gray(addr c);			/// Pushes c on the mark stack, to be marked
+	void Barrier(addr c, addr old) {	/// Write barrier
+		if (GCMode == GC_GENERATIONAL) { if (IsMarked(c)) Remember(c); }	/// Only old cells are marked out of gc
+		else if (GCPhase == GC_MARKING && old != 0 && !ISFIXNUM(old) && !IsMarked(old)) Gray(old);
+	}
 	void Mark(addr memaddr);	/// Garbage collection
-	void Sweep();				/// Garbage collection
+	bool Trace(long budget, long t0);	/// Marks from the mark stack. False if budget microseconds since t0 ran out first
+	void Sweep();				/// Garbage collection (generational mode)
+	addr LazyAt;				/// Cells from LazyAt to LazyEnd-1 are not swept yet
+	addr LazyEnd;
+	void LazySweep();			/// Sweeps chunks until some cell is available or all are swept
+	addr SweepChunk(addr from, addr to, addr *last);	/// Sweeps cells from..to-1. Returns the chain of available ones
+	
+	pthread_t Sweeper;			/// Background mode
+	bool SweeperStarted;
+	pthread_mutex_t SweeperLock;
+	pthread_cond_t  SweeperStart;
+	pthread_cond_t  SweeperDone;	/// Signaled as chunks are handed over, and when the sweep is over
+	int  SweeperEpoch;			/// Incremented to start a sweep
+	bool Sweeping;
+	addr SweeperEnd;			/// Cells from TCELL+1 to SweeperEnd-1 are swept
+	addr SweptHead;				/// Available cells handed over by the sweeper
+	addr SweptTail;
+	static void *SweeperMain(void *arg);
+	void StartSweeper();
+	void WaitSweeper();			/// Until the sweep is over
+	void TakeSwept(bool wait);	/// Takes the Swept list as FreeList. Waits for some if wait and the sweep is not over
+	void ClearMarks(addr from, addr to);	/// Of cells from..to-1, and maybe some next to them
+	
+	addr *Nursery;				/// Cells created since last gc (generational mode)
+	addr NurserySize;
+	addr *Remembered;			/// Old cells modified since last gc (generational mode)
+	addr RememberedCount;
+	addr RememberedSize;
+	unsigned char *RememberedBits;	/// To record each cell once
+	void Remember(addr c);
+	void MinorGC(const char *msg);
+	
+	MarkWorker *Workers;		/// GCThreads of them, once started
+	pthread_mutex_t WorkersLock;
+	pthread_cond_t  WorkersStart;
+	pthread_cond_t  WorkersDone;
+	int  WorkersEpoch;			/// Incremented to start a parallel mark
+	int  WorkersFinished;
+	int  WorkersIdle;			/// Threads out of work
+	static void *WorkerMain(void *arg);
+	void ParallelMark();		/// Marks from the roots with GCThreads threads
+	void MarkShare(int w);		/// Marks as thread w until all threads are out of work
+	void DequePush(MarkWorker &d, addr c);
+	bool DequePop(MarkWorker &d, addr &c);
+	bool Steal(int w, addr &c);
+	bool AnyWork();
+	void MinorSweep();
+	
+	addr SweepAt;				/// Cells from SweepAt down are not swept yet (incremental mode)
+	addr SweepFreed;
+	int  SliceNumber;			/// Slices done in the current cycle
+	long PauseMicros;			/// Time spent in slices, not yet added to GCTimeSpent
+	void IncrementalGC(const char *msg, bool full);
+	void StartCycle(const char *msg);
+	void Slice(long budget);	/// Budget is -1 to finish the cycle
+	bool SweepSome(long budget, long t0);
+	void Pause(long us);		/// Records a gc pause
+	addr CycleUsedCells;		/// UsedCells at the start of the cycle (incremental mode)
+	void AdaptTrigger(addr before);	/// Sets the next gc after a full gc, which started with before cells in use
+	
+	addr *Roots[16];			/// Registered by AddRoot
+	int  RootCount;
+	addr *RootStack;			/// Protected sexprs, grown as needed
+	addr RootStackSize;
+	addr RootStackTop;
+	void GrowRootStack();
+	void MarkRoots();			/// Marks from Roots and RootStack
+	int  GCsAtCompaction;		/// GCNumberDone at the last compaction
+	addr *Forward;				/// New address of each copied cell, 0 if not copied yet (Compact)
+	MemoryCell *ToMem;			/// Copies of the live cells, at their new addresses (Compact)
+	char *ToType;
+	addr ToTop;					/// Next new address (Compact)
+	addr Evacuate(addr c);		/// Compact companion
 	
-	void PrintList(addr sexpr);	/// Print companion
-	void CheckEndOfMemory();	/// Memory can be exhausted due to unfrequent garbage collections
+	void CheckEndOfMemory();	/// Grows the memory when all cells up to Size are taken
 };
 
 extern MemoryClass Memory;
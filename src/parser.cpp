@@ -24,7 +24,7 @@ addr ParserClass::Parse(int level) {
 		Ok = true;
 		CreateCellCount = 0;
 	}
-	if (USEDMEMPCT > PCT_TRIGGER_GC) Memory.GC("At parser");
+	if (GCNEEDED) Memory.GC("At parser");
 
 	char *token = NextToken();
 	if (Trace) { Blanks(level); printf("> \"%s\"\n", token); }
@@ -36,23 +36,23 @@ addr ParserClass::Parse(int level) {
 	else 		             result =  CreateCellForParser(token); // result =  Memory.CreateCell(token);
 	if (Trace) { Blanks(level); printf("< @%d\n", result); }
 	if (level == 0) 
-		for (int i = 0; i < CreateCellCount; i++) Lisp.Pop(_GCSAFE_);
+		Memory.Unprotect(CreateCellCount);
 	return result;
 }
 
 addr ParserClass::ParseQuote(int level) {
-	addr result = _NIL_;
-	CAR(result) = CreateCellForParser((char *)"'"); // CAR(result) = Memory.CreateCell((char *)"'");
-	addr quoted = _NIL_;
+	addr result = CreateCellForParser(0,0);
+	SETCAR(result, CreateCellForParser((char *)"'")); // SETCAR(result, Memory.CreateCell((char *)"'"));
+	addr quoted = CreateCellForParser(0,0);
 	addr q = Parse(level);
 	if (q == ENDOFSEXPR) {
 		printf("[parse] Bad quote\n");
 		Ok = false;
 		return _NIL_;
 	}
-	CAR(quoted) = q;
-	CDR(quoted) = _NIL_;
-	CDR(result) = quoted;
+	SETCAR(quoted, q);
+	SETCDR(quoted, _NIL_);
+	SETCDR(result, quoted);
 	return result;
 }
 
@@ -126,14 +126,14 @@ char ParserClass::NextChar() {
 
 addr ParserClass::CreateCellForParser(char *item) {
 	addr mc = Memory.CreateCell(item);
-	Lisp.Push(mc, _GCSAFE_);	
+	Memory.Protect(mc);
 	CreateCellCount++;
 	return mc;
 }
 
 addr ParserClass::CreateCellForParser(addr car, addr cdr) {
 	addr mc = Memory.CreateCell(car,cdr);
-	Lisp.Push(mc, _GCSAFE_);
+	Memory.Protect(mc);
 	CreateCellCount++;
 	return mc;
 }
@@ -8,12 +8,11 @@
 /**
  * This implements a tail recursive parser for sexprs using functions Parse, ParseQuote and ParseListItem.
  * 
- * Any memory cell needed by the parser is created by CreatedCellForParser, which also pushes the cell 
- * into the _GCSAFE_ stack and keeps a count of the created cells. This guarantees that the checks for
+ * Any memory cell needed by the parser is created by CreatedCellForParser, which also protects the cell 
+ * with Memory.Protect and keeps a count of the created cells. This guarantees that the checks for
  * garbage collection at the begining of Parse do not spoil the parsing tree being built.
  * 
- * When parsing is complete, the same number of memory cells created during the process are popped out 
- * of _GCSAFE_.
+ * When parsing is complete, the same number of memory cells created during the process are unprotected.
  * 
  */
 
@@ -0,0 +1,670 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "lisp.h"
+#include "memory.h"
+
+/**
+ * Bytecode compiler and virtual machine for defuned functions (see the notes in lisp.h).
+ *
+ * Code is an array of ints: an opcode followed by its operands. Operands named k are indexes in the
+ * constants array, j are code positions, d are levels relative to the level of the function body (for
+ * the interpreter and the trace output) and i are indexes in Func. The operand stack is Memory's RootStack,
+ * so that everything the VM holds is safe from gc with no further care.
+ */
+enum Opcodes {
+	OP_CONST,		/// k			Push constant k
+	OP_PARAM,		/// s			Push the value of parameter s
+	OP_SETPARAM,	/// s			Set parameter s to the top
+	OP_VAR,			/// k d			Push the value of symbol k, looked up in the bindings
+	OP_SETQ,		/// k			Set symbol k to the top, as setq does
+	OP_EVAL,		/// k d			Push the value of form k, evaled by the interpreter
+	OP_SEQ,			/// j			Between the forms of a sequence: jump to j if the top is RETURNMARK, else pop
+	OP_JUMP,		/// j
+	OP_JUMPNIL,		/// j			Pop, and jump to j if NIL
+	OP_JUMPNOTNIL,	/// j			Pop, and jump to j if not NIL
+	OP_BUILTIN,		/// i k d j		If builtin i is traced, push the value of form k evaled by the interpreter and jump to j
+	OP_ENTER,		/// k n d j		Before the arguments of call form k: push the lambda of its function if it is defuned,
+					///				takes n arguments and is not traced. Else push the value of form k evaled by the
+					///				interpreter and jump to j
+	OP_CALL,		/// k n d		Call the function of form k with the lambda and the n arguments on the stack
+	OP_TAILCALL,	/// k n d l		OP_CALL in tail position, inside l lets: a compiled callee replaces this code, with
+					///				no nested Run. The frames of the lets are left on the bindings until the return
+	OP_CARCDR,		/// k car		Replace the top by its car (or cdr if car is 0). k is the function symbol, for errors
+	OP_CONS,		///				Replace the two values on the top by their cons
+	OP_NUMBER,		/// s k n j		Unless the top is a number, print the error of function s for argument form k,
+					///				replace the top and the n items under it by NIL and jump to j
+	OP_ARITH,		/// s k j		Replace the two numbers on the top by the result of function s (+ - * /). On a
+					///				division by zero by argument form k, print the error, replace them by NIL and jump to j
+	OP_CMP,			/// k			Replace the two values on the top by their comparison by the function of form k
+	OP_MOD,			///				Replace the two values on the top by their mod
+	OP_NULL,		///				Replace the top by T if it is NIL, else by NIL
+	OP_ATOM,		///				Replace the top by T if it is an atom, else by NIL
+	OP_LIST,		/// n			Replace the n values on the top by the list of them
+	OP_NEWFRAME,	///				Push an empty assoc list
+	OP_BIND,		/// k			Pop a value and bind symbol k to it in the assoc list on the top
+	OP_PUSHFRAME,	/// n			Push the assoc list n items under the top onto the bindings
+	OP_POPFRAME,	///				Pop the bindings
+	OP_NIP,			/// n			Drop the n items under the top
+	OP_DOSTART,		/// i k j e		Start dotimes or dolist (builtin i) with variable k, over the count or list on the
+					///				top. Pushes the loop assoc list and the cursor. Jumps to j if there is nothing to
+					///				iterate, and to e with NIL on the top on error
+	OP_DONEXT,		/// i k b j e	After the body: jump back to b for the next iteration, to j when done, or to e
+					///				with the value of (return) on the top
+	OP_DOEND,		///				Pop RETURNS and push the loop assoc list onto the bindings, for the result form
+	OP_PUSHRETURNS,	///				Push NIL onto RETURNS, for a (return) from the body of a do
+	OP_DOBODY,		/// j			After the body of a do: if the top is RETURNMARK, replace it by the value of
+					///				(return) and jump to j, else pop it
+	OP_POPRETURNS,	///				Pop RETURNS
+	OP_RETURN		///				Return the top
+};
+
+#define VMMAXPARAMS	32	/** Functions with more parameters are not compiled */
+
+struct Compiler {
+	int  *ops;
+	int  size, opscap;
+	addr *consts;
+	int  nconsts, constscap;
+	int  lets; /// The lets in tail position around the form being compiled
+};
+
+static int Emit(Compiler &c, int word) {
+	if (c.size == c.opscap) {
+		c.opscap *= 2;
+		c.ops = (int *) realloc(c.ops, c.opscap*sizeof(int));
+	}
+	c.ops[c.size] = word;
+	return c.size++;
+}
+
+static void Patch(Compiler &c, int chain, int target) {
+	/// Jump operands still to be set hold the position of the previous one in their chain, or -1
+	while (chain >= 0) {
+		int prev = c.ops[chain];
+		c.ops[chain] = target;
+		chain = prev;
+	}
+}
+
+static int Const(Compiler &c, addr k) {
+	if (c.nconsts == c.constscap) {
+		c.constscap *= 2;
+		c.consts = (addr *) realloc(c.consts, c.constscap*sizeof(addr));
+	}
+	c.consts[c.nconsts] = k;
+	return c.nconsts++;
+}
+
+LispClass::Code *LispClass::Compiled(addr fname, addr params, addr body) {
+	Code *code = (Code *) CODE(fname);
+	if (code && code->stamp == Memory.GCCompactions) /// defun drops the code of the definition it replaces
+		return code->ops ? code : NULL;
+	Uncompile(fname); /// Stale: its cells moved
+	if (!DEFUN(fname) || CDR(CDR(DEFUN(fname))) != body) return NULL; /// A lambda found before a redefinition
+	code = (Code *) calloc(1, sizeof(Code));
+	code->body  = body;
+	code->stamp = Memory.GCCompactions;
+	CODE(fname) = code;
+	if (Length(params) > VMMAXPARAMS) return NULL;
+
+	Compiler c;
+	c.opscap    = 64;  c.size    = 0; c.ops    = (int *)  malloc(c.opscap*sizeof(int));
+	c.constscap = 16;  c.nconsts = 0; c.consts = (addr *) malloc(c.constscap*sizeof(addr));
+	c.lets      = 0;
+	Scope scope = { params, Distinct(params), NULL }; /// Else the parameters are looked up as other variables
+	CompileSequence(c, body, &scope, 0, true);
+	Emit(c, OP_RETURN);
+	code->ops     = c.ops;
+	code->consts  = c.consts;
+	code->nparams = Length(params);
+	return code;
+}
+
+void LispClass::Uncompile(addr fname) {
+	Code *code = (Code *) CODE(fname);
+	if (!code) return;
+	if (code->running) code->retired = true;
+	else FreeCode(code);
+	CODE(fname) = NULL;
+}
+
+void LispClass::FreeCode(Code *code) {
+	free(code->ops);
+	free(code->consts);
+	free(code);
+}
+
+void LispClass::CompileSequence(Compiler &c, addr list, const Scope *scope, int d, bool tail) {
+	if (TYPE(list) != 'C' || ISNIL(list) || ISEMPTY(list)) { /// EvalSequence of nothing is NIL
+		Emit(c, OP_CONST); Emit(c, Const(c, _NIL_));
+		return;
+	}
+	int leave = -1; /// RETURNMARK leaves the sequence
+	for (addr node = list; TYPE(node) == 'C' && !ISNIL(node); node = CDR(node)) {
+		bool last = (TYPE(CDR(node)) != 'C' || ISNIL(CDR(node)));
+		CompileForm(c, CAR(node), scope, d, tail && last);
+		if (!last) { Emit(c, OP_SEQ); leave = Emit(c, leave); }
+	}
+	Patch(c, leave, c.size);
+}
+
+void LispClass::CompileForm(Compiler &c, addr form, const Scope *scope, int d, bool tail) {
+	int slot, depth;
+	if (TYPE(form) == 'N' || form == _T_ || form == _NIL_) {
+		Emit(c, OP_CONST); Emit(c, Const(c, form));
+	}
+	else if (TYPE(form) == 'S') {
+		if ((slot = Slot(form, scope, &depth)) >= 0) { Emit(c, OP_PARAM); Emit(c, slot); }
+		else { Emit(c, OP_VAR); Emit(c, Const(c, form)); Emit(c, d); }
+	}
+	else if (ISEMPTY(form) || (TYPE(CAR(form)) != 'S' && CAR(form) != _LOCALREF_))
+		CompileEval(c, form, d);
+	else if (CAR(form) == _LOCALREF_) { /// Resolved by defun: always a parameter of this function
+		Emit(c, OP_PARAM); Emit(c, VALUE(CAR(CDR(form))) & 0xFFFF);
+	}
+	else if (FUNC(CAR(form)) >= 0)
+		CompileBuiltin(c, form, scope, d, tail);
+	else { /// A defuned function, checked at run time
+		addr args = CDR(form);
+		int  n    = Length(args);
+		Emit(c, OP_ENTER); Emit(c, Const(c, form)); Emit(c, n); Emit(c, d);
+		int skip = Emit(c, 0);
+		for (addr node = args; TYPE(node) == 'C' && !ISNIL(node); node = CDR(node))
+			CompileForm(c, CAR(node), scope, d+1);
+		Emit(c, tail ? OP_TAILCALL : OP_CALL); Emit(c, Const(c, form)); Emit(c, n); Emit(c, d);
+		if (tail) Emit(c, c.lets);
+		c.ops[skip] = c.size;
+	}
+}
+
+void LispClass::CompileEval(Compiler &c, addr form, int d) {
+	Emit(c, OP_EVAL); Emit(c, Const(c, form)); Emit(c, d);
+}
+
+void LispClass::CompileBuiltin(Compiler &c, addr form, const Scope *scope, int d, bool tail) {
+	int  i    = FUNC(CAR(form));
+	addr args = CDR(form);
+	int  n    = Length(args);
+	bool condok; /// As checked by Eval: otherwise the interpreter reports the error
+	switch (Func[i].cond) {
+		case '<': condok = (n <  Func[i].n); break;
+		case '=': condok = (n == Func[i].n); break;
+		case '>': condok = (n >  Func[i].n); break;
+		default:  condok = true;
+	}
+	addr (LispClass::*f)(addr, addr, int) = Func[i].f;
+	const char *fname = Func[i].fname;
+	bool dotimes = !strcasecmp(fname, "dotimes"), dolist = !strcasecmp(fname, "dolist");
+	if (!condok || !(f == &LispClass::quote || f == &LispClass::if_ || f == &LispClass::cond || f == &LispClass::bools ||
+		f == &LispClass::progn || f == &LispClass::setq || f == &LispClass::let || f == &LispClass::carcdr ||
+		f == &LispClass::cons || f == &LispClass::zoprs || f == &LispClass::zcmps || f == &LispClass::mod ||
+		f == &LispClass::null || f == &LispClass::atom || f == &LispClass::list || f == &LispClass::do_ ||
+		dotimes || dolist)) {
+		CompileEval(c, form, d);
+		return;
+	}
+	if (f == &LispClass::let && !Compilable(Nth(args,0), true)) 	 { CompileEval(c, form, d); return; }
+	if ((dotimes || dolist) && !Compilable(Nth(args,0), false)) 	 { CompileEval(c, form, d); return; }
+	if (f == &LispClass::do_ && !CompilableDo(args)) 				 { CompileEval(c, form, d); return; }
+	if (f == &LispClass::cond) {
+		for (addr node = args; TYPE(node) == 'C' && !ISNIL(node); node = CDR(node))
+			if (TYPE(CAR(node)) != 'C' || ISNIL(CAR(node)) || ISEMPTY(CAR(node))) { CompileEval(c, form, d); return; }
+	}
+	if (f == &LispClass::setq && TYPE(Nth(args,0)) != 'S') 		 { CompileEval(c, form, d); return; }
+
+	Emit(c, OP_BUILTIN); Emit(c, i); Emit(c, Const(c, form)); Emit(c, d);
+	int traced = Emit(c, 0);
+	d++; /// Builtins eval their arguments one level down
+	if (f == &LispClass::quote) {
+		Emit(c, OP_CONST); Emit(c, Const(c, Nth(args,0)));
+	}
+	else if (f == &LispClass::if_) {
+		CompileForm(c, Nth(args,0), scope, d);
+		Emit(c, OP_JUMPNIL); int jelse = Emit(c, 0);
+		CompileForm(c, Nth(args,1), scope, d, tail);
+		Emit(c, OP_JUMP); int jend = Emit(c, 0);
+		c.ops[jelse] = c.size;
+		CompileForm(c, Nth(args,2), scope, d, tail);
+		c.ops[jend] = c.size;
+	}
+	else if (f == &LispClass::cond) {
+		int end = -1;
+		for (addr node = args; TYPE(node) == 'C' && !ISNIL(node); node = CDR(node)) {
+			addr clause = CAR(node);
+			CompileForm(c, CAR(clause), scope, d);
+			Emit(c, OP_JUMPNIL); int next = Emit(c, 0);
+			CompileSequence(c, CDR(clause), scope, d, tail);
+			Emit(c, OP_JUMP); end = Emit(c, end);
+			c.ops[next] = c.size;
+		}
+		Emit(c, OP_CONST); Emit(c, Const(c, _NIL_));
+		Patch(c, end, c.size);
+	}
+	else if (f == &LispClass::bools) {
+		bool isand = !strcasecmp(fname, "and");
+		int decided = -1;
+		for (addr node = args; TYPE(node) == 'C' && !ISNIL(node); node = CDR(node)) {
+			CompileForm(c, CAR(node), scope, d);
+			Emit(c, isand ? OP_JUMPNIL : OP_JUMPNOTNIL); decided = Emit(c, decided);
+		}
+		Emit(c, OP_CONST); Emit(c, Const(c, isand ? _T_ : _NIL_));
+		Emit(c, OP_JUMP); int jend = Emit(c, 0);
+		Patch(c, decided, c.size);
+		Emit(c, OP_CONST); Emit(c, Const(c, isand ? _NIL_ : _T_));
+		c.ops[jend] = c.size;
+	}
+	else if (f == &LispClass::progn)
+		CompileSequence(c, args, scope, d, tail);
+	else if (f == &LispClass::setq) {
+		addr symbol = Nth(args,0);
+		int  slot, depth;
+		CompileForm(c, Nth(args,1), scope, d);
+		if ((slot = Slot(symbol, scope, &depth)) >= 0) { Emit(c, OP_SETPARAM); Emit(c, slot); }
+		else { Emit(c, OP_SETQ); Emit(c, Const(c, symbol)); }
+	}
+	else if (f == &LispClass::let) {
+		addr vars  = Nth(args,0);
+		bool star  = !strcasecmp(fname, "let*");
+		Scope inner = { vars, false, scope };
+		Emit(c, OP_NEWFRAME);
+		for (addr node = vars; TYPE(node) == 'C' && !ISNIL(node); node = CDR(node)) {
+			addr var = CAR(node);
+			if (TYPE(var) == 'S' || ISNIL(CDR(var))) { Emit(c, OP_CONST); Emit(c, Const(c, _NIL_)); }
+			else {
+				if (star) { Emit(c, OP_PUSHFRAME); Emit(c, 0); } /// let* evals with the variables bound so far
+				CompileForm(c, CAR(CDR(var)), star ? &inner : scope, d);
+				if (star) Emit(c, OP_POPFRAME);
+			}
+			Emit(c, OP_BIND); Emit(c, Const(c, TYPE(var) == 'S' ? var : CAR(var)));
+		}
+		addr body = CDR(args);
+		if (TYPE(body) != 'C' || ISNIL(body)) { Emit(c, OP_CONST); Emit(c, Const(c, _NIL_)); }
+		else {
+			Emit(c, OP_PUSHFRAME); Emit(c, 0);
+			if (tail) c.lets++;
+			CompileSequence(c, body, &inner, d, tail);
+			if (tail) c.lets--;
+			Emit(c, OP_POPFRAME);
+		}
+		Emit(c, OP_NIP); Emit(c, 1);
+	}
+	else if (dotimes || dolist) {
+		addr varspec = Nth(args,0);
+		Scope inner  = { varspec, false, scope };
+		CompileForm(c, Nth(varspec,1), scope, d);
+		Emit(c, OP_DOSTART); Emit(c, i); Emit(c, Const(c, CAR(varspec)));
+		int jempty = Emit(c, 0), jerror = Emit(c, 0);
+		int body = c.size;
+		CompileSequence(c, CDR(args), &inner, d);
+		Emit(c, OP_DONEXT); Emit(c, i); Emit(c, Const(c, CAR(varspec))); Emit(c, body);
+		int jdone = Emit(c, 0), jreturn = Emit(c, 0);
+		c.ops[jempty] = c.ops[jdone] = c.size;
+		Emit(c, OP_DOEND);
+		CompileForm(c, Nth(varspec,2), &inner, d);
+		Emit(c, OP_POPFRAME);
+		Emit(c, OP_NIP); Emit(c, 3);
+		c.ops[jerror] = c.ops[jreturn] = c.size;
+	}
+	else if (f == &LispClass::do_) {
+		addr vars = Nth(args,0), test = Nth(args,1);
+		Scope inner = { vars, false, scope };
+		Emit(c, OP_NEWFRAME);
+		for (addr node = vars; !ISNIL(node); node = CDR(node)) { /// The init forms are evaled before any is bound
+			CompileForm(c, Nth(CAR(node),1), scope, d);
+			Emit(c, OP_BIND); Emit(c, Const(c, CAR(CAR(node))));
+		}
+		Emit(c, OP_PUSHFRAME); Emit(c, 0);
+		Emit(c, OP_PUSHRETURNS);
+		int loop = c.size;
+		CompileForm(c, Nth(test,0), &inner, d);
+		Emit(c, OP_JUMPNOTNIL); int jdone = Emit(c, 0);
+		CompileSequence(c, CDR(CDR(args)), &inner, d);
+		Emit(c, OP_DOBODY); int jreturn = Emit(c, 0);
+		for (addr node = vars; !ISNIL(node); node = CDR(node)) { /// Each step form sees the steps before it, as in do_
+			CompileForm(c, Nth(CAR(node),2), &inner, d);
+			Emit(c, OP_BIND); Emit(c, Const(c, CAR(CAR(node))));
+		}
+		Emit(c, OP_JUMP); Emit(c, loop);
+		c.ops[jdone] = c.size;
+		CompileForm(c, Nth(test,1), &inner, d);
+		c.ops[jreturn] = c.size;
+		Emit(c, OP_POPRETURNS);
+		Emit(c, OP_POPFRAME);
+		Emit(c, OP_NIP); Emit(c, 1);
+	}
+	else if (f == &LispClass::carcdr) {
+		CompileForm(c, Nth(args,0), scope, d);
+		Emit(c, OP_CARCDR); Emit(c, Const(c, CAR(form))); Emit(c, !strcasecmp(fname, "car"));
+	}
+	else if (f == &LispClass::cons) {
+		CompileForm(c, Nth(args,0), scope, d);
+		CompileForm(c, Nth(args,1), scope, d);
+		Emit(c, OP_CONS);
+	}
+	else if (f == &LispClass::zoprs) { /// Stops at the first argument which is not a number
+		int error = -1, a = 0;
+		for (addr node = args; TYPE(node) == 'C' && !ISNIL(node); node = CDR(node), a++) {
+			CompileForm(c, CAR(node), scope, d);
+			Emit(c, OP_NUMBER); Emit(c, Const(c, CAR(form))); Emit(c, Const(c, CAR(node))); Emit(c, a ? 1 : 0);
+			error = Emit(c, error);
+			if (a) {
+				Emit(c, OP_ARITH); Emit(c, Const(c, CAR(form))); Emit(c, Const(c, CAR(node)));
+				error = Emit(c, error);
+			}
+		}
+		Patch(c, error, c.size);
+	}
+	else if (f == &LispClass::zcmps) {
+		CompileForm(c, Nth(args,0), scope, d);
+		CompileForm(c, Nth(args,1), scope, d);
+		Emit(c, OP_CMP); Emit(c, Const(c, form));
+	}
+	else if (f == &LispClass::mod) {
+		CompileForm(c, Nth(args,0), scope, d);
+		CompileForm(c, Nth(args,1), scope, d);
+		Emit(c, OP_MOD);
+	}
+	else if (f == &LispClass::null || f == &LispClass::atom) {
+		CompileForm(c, Nth(args,0), scope, d);
+		Emit(c, f == &LispClass::null ? OP_NULL : OP_ATOM);
+	}
+	else if (f == &LispClass::list) {
+		for (addr node = args; TYPE(node) == 'C' && !ISNIL(node); node = CDR(node))
+			CompileForm(c, CAR(node), scope, d);
+		Emit(c, OP_LIST); Emit(c, n);
+	}
+	c.ops[traced] = c.size;
+}
+
+bool LispClass::Compilable(addr vars, bool let) {
+	/// The variable specs the VM handles as the interpreter does: anything else is left to the interpreter
+	if (TYPE(vars) != 'C' || ISEMPTY(vars)) return false;
+	if (!let) { /// (var count-or-list [result-form])
+		int n = Length(vars);
+		return !ISNIL(vars) && (n == 2 || n == 3) && TYPE(CAR(vars)) == 'S';
+	}
+	for (addr node = vars; !ISNIL(node); node = CDR(node)) {
+		if (TYPE(node) != 'C') return false;
+		addr var = CAR(node);
+		if (TYPE(var) == 'S') continue;
+		if (TYPE(var) != 'C' || ISNIL(var) || ISEMPTY(var) || TYPE(CAR(var)) != 'S') return false;
+	}
+	return true;
+}
+
+bool LispClass::CompilableDo(addr args) {
+	/// A do with a variable spec which is not (var init-form step-form), a repeated variable or no test form is
+	/// left to the interpreter, which reports the errors
+	addr vars = Nth(args,0), test = Nth(args,1);
+	if (TYPE(vars) != 'C' || ISNIL(vars) || ISEMPTY(vars)) return false;
+	if (TYPE(test) != 'C' || ISNIL(test) || ISEMPTY(test)) return false;
+	for (addr node = vars; !ISNIL(node); node = CDR(node)) {
+		if (TYPE(node) != 'C') return false;
+		addr var = CAR(node);
+		if (TYPE(var) != 'C' || ISNIL(var) || ISEMPTY(var) || Length(var) != 3 || TYPE(CAR(var)) != 'S') return false;
+		for (addr prev = vars; prev != node; prev = CDR(prev))
+			if (CAR(CAR(prev)) == CAR(var)) return false;
+	}
+	return true;
+}
+
+#define TOP			Memory.Protected(0)
+#define NEXT		Memory.Protected(1)
+#define K(x)		code->consts[x]
+
+static void Pairs(addr frame, addr *pairs, int n) {
+	int np = 0;
+	for (addr node = frame; np < n && !ISEMPTY(node) && !ISNIL(node); node = CDR(node)) pairs[np++] = CAR(node);
+}
+
+addr LispClass::Run(Code *code, addr frame, addr bindings, int level) {
+	addr pairs[VMMAXPARAMS]; /// The parameter bindings in the frame built for the call
+	Pairs(frame, pairs, code->nparams);
+	int frames = 1; /// On top of the bindings: the frame of the call, and those pushed by tail calls
+	Deeper();
+	code->running++;
+	Memory.Protect(code->body); /// So that its constants outlive a redefinition while running
+	int *ops = code->ops;
+	int  pc  = 0;
+	addr v;
+	for (;;) {
+		int op = ops[pc++];
+		switch (op) {
+		case OP_CONST:		Memory.Protect(K(ops[pc])); pc++; break;
+		case OP_PARAM:		Memory.Protect(CDR(pairs[ops[pc]])); pc++; break;
+		case OP_SETPARAM:	SETCDR(pairs[ops[pc]], TOP); pc++; break;
+		case OP_VAR:		v = Eval(K(ops[pc]), bindings, level+ops[pc+1]); Memory.Protect(v); pc += 2; break;
+		case OP_SETQ:		SetSymbolValue(K(ops[pc]), TOP, bindings); pc++; break;
+		case OP_EVAL:		v = Eval(K(ops[pc]), bindings, level+ops[pc+1]); Memory.Protect(v); pc += 2; break;
+		case OP_SEQ:		if (TOP == RETURNMARK) pc = ops[pc]; else { Memory.Unprotect(); pc++; } break;
+		case OP_JUMP:		pc = ops[pc]; break;
+		case OP_JUMPNIL:	v = TOP; Memory.Unprotect(); pc = ISNIL(v) ? ops[pc] : pc+1; break;
+		case OP_JUMPNOTNIL:	v = TOP; Memory.Unprotect(); pc = ISNIL(v) ? pc+1 : ops[pc]; break;
+		case OP_BUILTIN:
+			if (Func[ops[pc]].traced) {
+				v = Eval(K(ops[pc+1]), bindings, level+ops[pc+2]); Memory.Protect(v);
+				pc = ops[pc+3];
+			}
+			else pc += 4;
+			break;
+		case OP_ENTER: {
+			addr form = K(ops[pc]), lambda = DEFUN(CAR(form)) ? CDR(DEFUN(CAR(form))) : 0;
+			if (!lambda || Length(CAR(lambda)) != ops[pc+1] ||
+				TRACED(CAR(form))) { /// Errors and trace output as the interpreter does
+				v = Eval(form, bindings, level+ops[pc+2]); Memory.Protect(v);
+				pc = ops[pc+3];
+			}
+			else { Memory.Protect(lambda); pc += 4; }
+			break;
+		}
+		case OP_CALL:
+		case OP_TAILCALL: {
+			addr fname  = CAR(K(ops[pc]));
+			int  n      = ops[pc+1];
+			int  l      = level+ops[pc+2];
+			addr lambda = Memory.Protected(n); /// As found by OP_ENTER, as the interpreter does before the arguments
+			pc += 3;
+			if (GCNEEDED) Memory.GC("At Eval");
+			addr bndg = _NEWLIST_;
+			Memory.Protect(bndg);
+			addr param = CAR(lambda);
+			for (int a = 0; a < n; a++, param = CDR(param)) AssocListSet(bndg, CAR(param), Memory.Protected(n-a));
+			Code *callee = Compiled(fname, CAR(lambda), CDR(lambda));
+			if (op == OP_TAILCALL && callee) { /// Nothing is left on the stack but the body and the lets: go on with the callee
+				int lets = ops[pc++];
+				frames += lets;
+				EnterFrame(bndg, bindings, &frames, true);
+				Memory.Unprotect(n+2+lets);
+				TOP = callee->body;
+				if (--code->running == 0 && code->retired) FreeCode(code);
+				code = callee;
+				code->running++;
+				Pairs(bndg, pairs, code->nparams);
+				ops   = code->ops;
+				pc    = 0;
+				level = l+1;
+				break;
+			}
+			if (op == OP_TAILCALL) pc++;
+			Push(bndg, bindings);
+			v = callee ? Run(callee, bndg, bindings, l+1) : EvalSequence(CDR(lambda), bindings, l+1);
+			Pop(bindings);
+			Memory.Unprotect(n+2);
+			Memory.Protect(v);
+			break;
+		}
+		case OP_CARCDR:
+			v = TOP;
+			if (TYPE(v) != 'C') {
+				printf("[error] %s: Bad list: ", NAME(K(ops[pc]))); Print(v); TOP = _NIL_;
+			}
+			else if (!ISNIL(v)) TOP = ops[pc+1] ? CAR(v) : CDR(v);
+			pc += 2;
+			break;
+		case OP_CONS:
+			v = Memory.CreateCell(NEXT, TOP);
+			Memory.Unprotect();
+			TOP = v;
+			break;
+		case OP_NUMBER:
+			if (TYPE(TOP) != 'N') {
+				printf("[error] %s: Bad number ", NAME(K(ops[pc]))); Print(K(ops[pc+1]));
+				Memory.Unprotect(ops[pc+2]);
+				TOP = _NIL_;
+				pc = ops[pc+3];
+			}
+			else pc += 4;
+			break;
+		case OP_ARITH: {
+			long x = VALUE(NEXT), y = VALUE(TOP);
+			char op = *NAME(K(ops[pc]));
+			Memory.Unprotect();
+			if (op == '/' && y == 0) {
+				printf("[error] /: Division by zero "); Print(K(ops[pc+1]));
+				TOP = _NIL_;
+				pc = ops[pc+2];
+				break;
+			}
+			switch (op) {
+				case '+': x += y; break;
+				case '-': x -= y; break;
+				case '*': x *= y; break;
+				case '/': x /= y; break;
+			}
+			TOP = Memory.CreateCell(x);
+			pc += 3;
+			break;
+		}
+		case OP_CMP: {
+			addr n1 = NEXT, n2 = TOP;
+			char *fname = NAME(CAR(K(ops[pc])));
+			Memory.Unprotect();
+			if (TYPE(n1) != 'N' || TYPE(n2) != 'N') {
+				printf("[error] %s: Bad numbers ", fname); Print(K(ops[pc])); TOP = _NIL_;
+			}
+			else {
+				bool cd = false;
+				switch (*fname) {
+					case '=': cd = VALUE(n1) == VALUE(n2); break;
+					case '>': cd = VALUE(n1) >  VALUE(n2); break;
+					case '<': cd = VALUE(n1) <  VALUE(n2); break;
+				}
+				TOP = cd ? _T_ : _NIL_;
+			}
+			pc++;
+			break;
+		}
+		case OP_MOD: {
+			addr x = NEXT, y = TOP;
+			Memory.Unprotect();
+			if (TYPE(x) != 'N' || TYPE(y) != 'N') {
+				printf("[error] mod: Arguments must be integers\n"); TOP = _NIL_;
+			}
+			else if (VALUE(y) == 0) {
+				printf("[error] mod: Division by zero\n"); TOP = _NIL_;
+			}
+			else TOP = Memory.CreateCell(VALUE(x) % VALUE(y));
+			break;
+		}
+		case OP_NULL:		TOP = ISNIL(TOP) ? _T_ : _NIL_; break;
+		case OP_ATOM:		v = TOP; TOP = (ISNIL(v) || TYPE(v) == 'S' || TYPE(v) == 'N') ? _T_ : _NIL_; break;
+		case OP_LIST: {
+			int  n    = ops[pc++];
+			addr list = _NIL_;
+			for (int a = 0; a < n; a++) list = Memory.CreateCell(Memory.Protected(a), list);
+			Memory.Unprotect(n);
+			Memory.Protect(list);
+			break;
+		}
+		case OP_NEWFRAME:	Memory.Protect(_NEWLIST_); break;
+		case OP_BIND:		v = TOP; Memory.Unprotect(); AssocListSet(TOP, K(ops[pc]), v); pc++; break;
+		case OP_PUSHFRAME:	Push(Memory.Protected(ops[pc]), bindings); pc++; break;
+		case OP_POPFRAME:	Pop(bindings); break;
+		case OP_NIP:		v = TOP; Memory.Unprotect(ops[pc]); TOP = v; pc++; break;
+		case OP_DOSTART: {
+			bool dolist = !strcasecmp(Func[ops[pc]].fname, "dolist");
+			addr var  = K(ops[pc+1]);
+			addr iter = TOP;
+			if (dolist ? TYPE(iter) != 'C' : TYPE(iter) != 'N') {
+				if (dolist) printf("[error] dolist: Bad iteration list: ");
+				else		printf("[error] dotimes: Bad max iteration: ");
+				Print(iter);
+				TOP = _NIL_;
+				pc = ops[pc+3];
+				break;
+			}
+			addr bndgs = _NEWLIST_;
+			Memory.Protect(bndgs);
+			Push(_NIL_, _RETURNS_); /// Get ready for a potential (return) from body
+			addr cursor = dolist ? (ISEMPTY(iter) ? _NIL_ : iter) : Memory.CreateCell(0L);
+			Memory.Protect(cursor);
+			if (dolist && ISNIL(cursor)) {
+				AssocListSet(bndgs, var, _NIL_);
+				pc = ops[pc+2];
+				break;
+			}
+			AssocListSet(bndgs, var, dolist ? CAR(cursor) : cursor);
+			Push(bndgs, bindings);
+			pc += 4;
+			break;
+		}
+		case OP_DONEXT: {
+			bool dolist = !strcasecmp(Func[ops[pc]].fname, "dolist");
+			addr var = K(ops[pc+1]);
+			v = TOP;
+			Memory.Unprotect();
+			Pop(bindings);
+			if (v == RETURNMARK) {
+				Memory.Unprotect(3);
+				Memory.Protect(CAR(_RETURNS_));
+				Pop(_RETURNS_);
+				pc = ops[pc+4];
+				break;
+			}
+			addr bndgs = NEXT;
+			bool done;
+			if (dolist) {
+				TOP  = CDR(TOP);
+				done = ISNIL(TOP);
+				AssocListSet(bndgs, var, done ? _NIL_ : CAR(TOP));
+			}
+			else {
+				long i = VALUE(TOP)+1;
+				TOP  = Memory.CreateCell(i);
+				done = (i == VALUE(Memory.Protected(2)));
+				AssocListSet(bndgs, var, Memory.CreateCell(i));
+			}
+			if (done) pc = ops[pc+3];
+			else {
+				if (GCNEEDED) Memory.GC("At Eval");
+				Push(bndgs, bindings);
+				pc = ops[pc+2];
+			}
+			break;
+		}
+		case OP_DOEND:		Pop(_RETURNS_); Push(NEXT, bindings); break;
+		case OP_PUSHRETURNS:	Push(_NIL_, _RETURNS_); break;
+		case OP_DOBODY:
+			if (TOP == RETURNMARK) {
+				TOP = CAR(_RETURNS_);
+				pc = ops[pc];
+			}
+			else {
+				Memory.Unprotect();
+				if (GCNEEDED) Memory.GC("At Eval");
+				pc++;
+			}
+			break;
+		case OP_POPRETURNS:	Pop(_RETURNS_); break;
+		case OP_RETURN:
+			v = TOP;
+			Memory.Unprotect(2); /// The result and the body
+			for (; frames > 1; frames--) Pop(bindings); /// The frame of the call is left to the caller
+			if (--code->running == 0 && code->retired) FreeCode(code);
+			Depth--;
+			return v;
+		}
+	}
+}
@@ -30,6 +30,9 @@
 	((dotimes (n 10 n))										10)
 	((eq (cons 1 2) (cons 1 2))								nil)
 	((eql (cons 1 2) (cons 1 2))							nil)
+	((eq 'Foo 'foo)										t)
+	((+ 1073741823 1)										1073741824)
+	((* -100000 100000)										-10000000000)
 	((equal (cons 1 2) (cons 1 2))							t)
 	((equal (list 1 2) (list 1 2))							t)
 	((let (form) (setq form '(* 2 3)) (eval form))			6)
@@ -44,14 +47,43 @@
 			(setq x (+ 1 x))
 			(if (= x 10) (return 'done))))					'done)
 	((mapcar 'list '(a b) '(1 2))							'((a 1) (b 2)))
+	((let (l) (push 1 l) (push 2 l) l)						'(2 1))
+	((let ((l (list 1 2))) (pop l) (pop l) l)				nil)
 	((let ((x 1) y (z 2)) z) 								2)
 	((let ((x 1) y (z 2)) y) 								nil)
 	((let ()) 												nil)
 	((apply '+ '(1 2))										3)
 	((funcall '+ 1 2)										3)
+	((progn (defun tail-loop (n) (if (= n 0) 'done (tail-loop (- n 1))))
+		(tail-loop 50000))									'done)
+	((let ((body (list '(+ x 1))))
+		(eval (cons 'defun (cons 'resolved (cons '(x) body))))
+		(list (resolved 1) (equal body '((+ x 1))))) 		'(2 t))
+	((progn (defun resolved-lambda (x) ((lambda (y) (+ x y)) 2))
+		(resolved-lambda 1))								3)
+	((progn (defun let-depth-h (x) (let () (let ((a 1)) x)))
+		(defun let-depth-k (x) (+ 0 (let-depth-h 5)))
+		(let-depth-k 7))											5)
+	((progn (defun let-depth-k (x) (+ 0 ((lambda (x) (let ((a 1)) (let ((a 2)) x))) 5)))
+		(let-depth-k 7))											5)
+	((progn (defun compiled-dolist (l) (dolist (x l 'none) (if (> x 2) (return x))))
+		(list (compiled-dolist '(1 2 3 4)) (compiled-dolist '(1 2))))	'(3 none))
+	((progn (defun compiled-dotimes (n) (dotimes (i n 'none) (if (= i 5) (return (* i 10)))))
+		(list (compiled-dotimes 10) (compiled-dotimes 3)))			'(50 none))
+	((progn (defun compiled-do (n)
+			(do ((i 0 (+ i 1)) (acc 0 (+ acc i))) ((= i n) acc) (if (> acc 100) (return 'big))))
+		(list (compiled-do 5) (compiled-do 100)))					'(15 big))
+	((progn (defun redefined (x) (+ x 1)) (redefined 1)
+		(defun redefined (x) (* x 10)) (redefined 2))				20)
+	((progn (defun redefined () 1) (redefined) (defun redefined () 2) (gc)
+		(defun redefined () 3) (redefined))						3)
+	((progn (defun compiled-div (x y) (list (/ x y) (mod x y)))
+		(list (compiled-div 7 2) (compiled-div 7 0) (/ 7 0)))		'((3 1) (nil nil) nil))
 	((type-of 1)											'integer)
 	((type-of 'one)											'symbol)
 	((type-of '(1 2))										'cons)
+	((gc-policy 'growth (gc-policy 'growth))				100)
+	((save-image 'testcases.image)							t)
 ))
 
 (defun run (times)
@@ -70,3 +102,7 @@
 ; the garbage collection mechanism
 (print (run 1))
 
+; Past --max-depth the REPL aborts the form and recovers (see testcases.sh).
+; Last, as the abort also drops the rest of the load
+(defun deep (n) (if (= n 0) 0 (+ 1 (deep (- n 1)))))
+(deep 10000000)
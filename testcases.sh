@@ -0,0 +1,60 @@
+#!/bin/sh
+# Runs testcases.lisp under each gc mode, on a heap small enough for gcs to happen all along the tests,
+# and once more from the memory image the tests save. The tests end past --max-depth, which is kept low
+# so that the heap holds the frames: the REPL must abort that form and go on.
+# Execute with make test. Exits with 1 if any mode fails.
+
+LISP=${LISP:-./lisp}
+HEAP=${HEAP:-"--heap 4K --heap-max 64K --max-depth 1000"}
+failed=0
+for gc in marksweep generational copying incremental background "marksweep --gc-threads 4"; do
+	rm -f testcases.image
+	out=$(printf "(load 'testcases.lisp)\n(print 'repl-recovered)\n" | $LISP --gc $gc $HEAP 2>&1)
+	# The tests saved an image: start from it and run them again
+	out="$out
+$(echo "(print (run 1))" | $LISP --gc $gc $HEAP --image testcases.image 2>&1)"
+	if echo "$out" | grep -q "test-failed" || [ $(echo "$out" | grep -c "all-tests-done") != 2 ] ||
+		! echo "$out" | grep -q "Maximum depth exceeded" || ! echo "$out" | grep -q "repl-recovered"; then
+		echo "$out" | grep -v "^\[   gc\]"
+		echo "FAILED --gc $gc"
+		failed=1
+	else
+		echo "passed --gc $gc"
+	fi
+done
+rm -f testcases.image
+
+# Trace output goes to the --trace-file. The trace of a form aborted by the depth limit is looked for while
+# the REPL still runs, as the end of input flushes it anyway
+rm -f testcases.trace
+out=$({
+	printf "(defun traced-sq (x) (* x x))\n(trace traced-sq)\n(traced-sq 3)\n"
+	printf "(defun traced-deep (n) (if (= n 0) 0 (+ 1 (traced-deep (- n 1)))))\n(trace traced-deep)\n(traced-deep 1000)\n"
+	for i in 1 2 3 4 5 6 7 8 9 10; do
+		grep -q ">>> traced-deep 950" testcases.trace 2>/dev/null && break
+		sleep 1
+	done
+	grep -q ">>> traced-deep 950" testcases.trace 2>/dev/null && echo "(print 'trace-flushed)"
+} | $LISP --max-depth 200 --trace-file testcases.trace 2>&1)
+if ! echo "$out" | grep -q "Maximum depth exceeded" || ! echo "$out" | grep -q "trace-flushed" ||
+	! grep -q ">>> traced-sq 3" testcases.trace || ! grep -q "<<< 9" testcases.trace; then
+	echo "$out"
+	echo "FAILED --trace-file"
+	failed=1
+else
+	echo "passed --trace-file"
+fi
+rm -f testcases.trace
+
+# An aborted load closes its file: with few descriptors allowed, many of them must not run out
+printf "(defun deep (n) (if (= n 0) 0 (+ 1 (deep (- n 1)))))\n(deep 10000000)\n" > testcases.deep
+out=$(ulimit -n 16; for i in $(seq 30); do echo "(load 'testcases.deep)"; done | $LISP --max-depth 1000 2>&1)
+if [ $(echo "$out" | grep -c "Maximum depth exceeded") != 30 ]; then
+	echo "$out" | grep "error"
+	echo "FAILED aborted loads"
+	failed=1
+else
+	echo "passed aborted loads"
+fi
+rm -f testcases.deep
+exit $failed